@@ -30,6 +30,16 @@
 
 #include <HTTPlib.h>
 
+// client response body states (see bodyRead)
+#define RB_BODY    0       //Content-Length body (rleft -1: until link closed)
+#define RB_SIZE    1       //chunk size line
+#define RB_EXT     2       //chunk extensions
+#define RB_DATA    3       //chunk data (rleft bytes)
+#define RB_CRLF    4       //line end after chunk data
+#define RB_TRAILER 5       //trailers after last chunk
+#define RB_END     6       //body complete
+#define RB_ERR     7       //bad chunked body (read stopped)
+
 //Text for standard http headers
 	prog_char rnok[] PROGMEM="HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n"; 
 	prog_char rerr[] PROGMEM="HTTP/1.1 500 ServerErr\r\nContent-Length: 0\r\n\r\n"; 
@@ -41,27 +51,78 @@
   "Content-Length: 0\r\n\r\n";
   
    
-  prog_char rlong[] PROGMEM=
-	"HTTP/1.1 200 OK\r\n"
-	"Server: Arduino-MWIFI/2.4\r\n"  
-	"Content-Type: text/html\r\n"
-	"Cache-Control: no-cache\r\n"
-	"Connection: keep-alive\r\n"
-//	"Connection: close\r\n"
- 	"Transfer-Encoding: chunked\r\n\r\n"; 
- 	
- 	prog_char rshort[] PROGMEM=
-	"HTTP/1.1 200 OK\r\n"
-	"Server: Arduino-MWIFI/2.4\r\n"  
+  prog_char rok[] PROGMEM="HTTP/1.1 200 OK\r\n";
+  prog_char hserver[] PROGMEM="Server: Arduino-MWIFI/2.4\r\n";
+  prog_char rhead[] PROGMEM=
 	"Content-Type: text/html\r\n"
-	"Cache-Control: no-cache\r\n"
-	"Connection: keep-alive\r\n";
+	"Cache-Control: no-cache\r\n";
+	
+  prog_char hctype[] PROGMEM="Content-Type: ";
+  prog_char hgzip[] PROGMEM="Content-Encoding: gzip\r\n";
+  prog_char hvary[] PROGMEM="Vary: Accept-Encoding\r\n";
+  prog_char hnocache[] PROGMEM="Cache-Control: no-cache\r\n";
+  prog_char crlf[] PROGMEM="\r\n";
+  prog_char hetag[] PROGMEM="ETag: ";
+  prog_char hmaxage[] PROGMEM="Cache-Control: max-age=";
+  prog_char r304[] PROGMEM="HTTP/1.1 304 Not Modified\r\n";
+  prog_char http11[] PROGMEM="HTTP/1.1 ";
+  
+// reason phrases of response builder (see statusText)
+  prog_char s200[] PROGMEM="OK";
+  prog_char s201[] PROGMEM="Created";
+  prog_char s204[] PROGMEM="No Content";
+  prog_char s304[] PROGMEM="Not Modified";
+  prog_char s400[] PROGMEM="Bad Request";
+  prog_char s401[] PROGMEM="Unauthorized";
+  prog_char s403[] PROGMEM="Forbidden";
+  prog_char s404[] PROGMEM="Not Found";
+  prog_char s405[] PROGMEM="Method Not Allowed";
+  prog_char s409[] PROGMEM="Conflict";
+  prog_char s413[] PROGMEM="Payload Too Large";
+  prog_char s500[] PROGMEM="Internal Server Error";
+  prog_char s503[] PROGMEM="Service Unavailable";
+  prog_char sNone[] PROGMEM="Status";
+  
+// content types of WEBASSET (ASSETHTML...)
+  prog_char tHtml[] PROGMEM="text/html";
+  prog_char tCss[] PROGMEM="text/css";
+  prog_char tJs[] PROGMEM="application/javascript";
+  prog_char tJson[] PROGMEM="application/json";
+  prog_char tText[] PROGMEM="text/plain";
+  prog_char tPng[] PROGMEM="image/png";
+  prog_char tJpeg[] PROGMEM="image/jpeg";
+  prog_char tGif[] PROGMEM="image/gif";
+  prog_char tIco[] PROGMEM="image/x-icon";
+  prog_char tSvg[] PROGMEM="image/svg+xml";
+  prog_char tBin[] PROGMEM="application/octet-stream";
+  PGM_P const assetTypes[] PROGMEM={tHtml,tCss,tJs,tJson,tText,tPng,tJpeg,
+                                    tGif,tIco,tSvg,tBin};
+	
+  prog_char hkeep[] PROGMEM="Connection: keep-alive\r\n";
+  prog_char hclose[] PROGMEM="Connection: close\r\n";
+  prog_char rchunked[] PROGMEM="Transfer-Encoding: chunked\r\n\r\n"; 
 
    
-  prog_char headerAuth[] PROGMEM="Authorization: Basic "; 
+  prog_char r400[] PROGMEM="HTTP/1.1 400 Bad Request\r\n"; 
+  prog_char r406[] PROGMEM="HTTP/1.1 406 Not Acceptable\r\n"; 
+  prog_char r405[] PROGMEM="HTTP/1.1 405 Method Not Allowed\r\nAllow: GET, HEAD, POST\r\n"; 
+  prog_char r414[] PROGMEM="HTTP/1.1 414 URI Too Long\r\n"; 
+  prog_char r431[] PROGMEM="HTTP/1.1 431 Request Header Fields Too Large\r\n"; 
+  prog_char rclose0[] PROGMEM="Connection: close\r\nContent-Length: 0\r\n\r\n";
+   
+  prog_char headerAuth[] PROGMEM="Authorization"; 
+  prog_char headerINM[] PROGMEM="If-None-Match"; 
+  prog_char headerCType[] PROGMEM="Content-Type"; 
+  prog_char basicAuth[] PROGMEM="Basic "; 
   prog_char headerLen[] PROGMEM="Content-Length: ";
+  prog_char headerHost[] PROGMEM="Host: ";
   
   prog_char http[] PROGMEM=" HTTP/1.1\r\n"; 
+  prog_char mGET[] PROGMEM="GET "; 
+  prog_char mPOST[] PROGMEM="POST "; 
+  prog_char mPUT[] PROGMEM="PUT "; 
+  prog_char mDELETE[] PROGMEM="DELETE "; 
+  char hkeepreq[]="Connection: keep-alive";
    	
   
   char NOPAGE[]=RESPERR;      //text for error response
@@ -85,33 +146,152 @@
 *  Second version with basic autentication flag (set true for autentication))
 */
 char* HTTP::getRequest(int socket,int nres,WEBRES rs[])
-{getRequest(socket,nres,rs,NULL);}
+{return getRequest(socket,nres,rs,NULL);}
 
 char* HTTP::getRequest(int socket,int nres,WEBRES rs[],char *key)
 {
-	char* line=readLine(socket); 
-	if (line==NULL) return NULL;
+	if (handleRequest(socket,nres,rs,key,true)>0) return Resource.name;
+	return NULL;
+}
+
+/*
+*  Request handling. Request is fed to Parser as it arrives (REQTOUT millisec
+*  max after its first byte), and read exactly (headers and Content-Length 
+*  body), so a following request on the same link is not lost.
+*  Resource.keep: link can be kept after response (keepok and HTTP/1.1 
+*  without "Connection: close")
+*  HEAD request is served as GET, but responses send header only.
+*  Bad request (or method, or too long) is answered as soon as found (400, 
+*  405, 414, 431) and its rest is not read: link must be closed 
+*  (Resource.keep false).
+*  Returns 0 if no request, 1 if request served, -1 if error answered.
+*/
+int HTTP::handleRequest(int socket,int nres,WEBRES rs[],char *key,bool keepok)
+{
+  int n,used,r=HPMORE;
+  uint8_t *data;
+  char auth[AUTHLEN];
+  unsigned long t=millis();
+  Resource.sk=socket;
+  Resource.keep=keepok;
+  Parser.begin(Resource.name,URILEN,Resource.query,QUERYLEN);
+  if (key!=NULL) Parser.watch(headerAuth,auth,AUTHLEN);
+  Parser.watch(headerINM,Resource.inm,ETAGLEN);
+  while (r==HPMORE)
+  {
+    data=dataBuffered(socket,&n);
+    if (n==0)
+    {
+      if (!Parser.started()) return 0;                  //no request
+      if (millis()-t>REQTOUT) {r=HPBAD;break;}          //request not complete
+      pause(10,REQTOUT-(millis()-t));
+      continue;
+    }
+    r=Parser.parse(data,n,&used);
+    dataConsumed(used);
+  }
+  Resource.method=Parser.method;
 #if HTTPDEBUG
-  Serial.println(line);
+  Serial.print(r);Serial.print(' ');Serial.print(Resource.name);
+  Serial.print('?');Serial.println(Resource.query);
 #endif  	
-	if (memcmp(line,"GET",3)==0) {reqGET(socket,line,nres,rs,key);return Resource.name;}
-	if (memcmp(line,"POST",4)==0) {reqPOST(socket,line,nres,rs,key);return Resource.name;}
-	cleanBuff(socket);
-	return NULL;
+  if (r!=HPDONE) {respCode(socket,r);resetBuff();return -1;}   //rest not read
+  if ((Parser.version==10)||(Parser.flags&(HPCLOSE|HPCHUNKED))) Resource.keep=false;
+  if ((Routes==NULL)&&!(Parser.method&(HPGET|HPPOST|HPHEAD))) 
+    {respCode(socket,HPMETHOD);resetBuff();return -1;}
+  if (Parser.clen>0) 
+    readBody(socket,Parser.clen,(Parser.method&(HPPOST|HPPUT))!=0);
+  bool fauth=true;
+  if (key!=NULL) 
+    fauth=(strncmp_P(auth,basicAuth,strlen_P(basicAuth))==0)&&
+          checkUserPsw(&auth[strlen_P(basicAuth)],key);
+  if (fauth) {if (Routes!=NULL) activateRoute(socket);else activateRes(socket,nres,rs);}
+  else respNoAuth(socket);
+  return 1;
+}
+
+/*
+*  Multi client server: listening socket and table of client links.
+*/
+uint8_t HTTP::startServer(uint16_t port)
+{
+  uint8_t i;
+  for (i=0;i<SERVCLIENTS;i++) Server.csk[i]=0xFF;
+  Server.next=0;Server.tacc=millis();Server.iacc=0;
+  Server.ssk=openServerTCP(port);
+  return Server.ssk;
+}
+
+void HTTP::stopServer()
+{
+  uint8_t i;
+  for (i=0;i<SERVCLIENTS;i++) 
+    {if (Server.csk[i]!=0xFF) {closeSock(Server.csk[i]);Server.csk[i]=0xFF;}}
+  if (Server.ssk!=0xFF) {closeSock(Server.ssk);Server.ssk=0xFF;}
+}
+
+char* HTTP::serveRequests(int nres,WEBRES rs[])
+{return serveRequests(nres,rs,NULL);}
+
+char* HTTP::serveRequests(int nres,WEBRES rs[],char *key)
+{
+  uint8_t i,k,sk;
+  int r;
+  if (Server.ssk==0xFF) return NULL;
+  serverAccept();
+  for (k=0;k<SERVCLIENTS;k++)              //round robin: first link with data
+  {
+    i=Server.next;
+    Server.next=(Server.next+1)%SERVCLIENTS;
+    sk=Server.csk[i];
+    if (sk==0xFF) continue;
+    r=handleRequest(sk,nres,rs,key,Server.nreq[i]<MAXREQS-1);
+    if (r==0) 
+    {
+      if (millis()-Server.tlast[i]>CLIENTIDLE) {closeSock(sk);Server.csk[i]=0xFF;}
+      continue;
+    }
+    Server.nreq[i]++;Server.tlast[i]=millis();
+    if (!Resource.keep) {closeSock(sk);Server.csk[i]=0xFF;}
+    else if (lineLeft(sk)>0) Server.next=i; //next request already read: first
+    if (r>0) return Resource.name;
+  }
+  return NULL;
+}
+
+/*
+*  Accept polling (cmd 115) if a table slot is free. The interval doubles 
+*  (ACCEPTMIN to ACCEPTMAX) while nobody asks, and it is reset when a link is
+*  accepted (others may be waiting).
+*/
+void HTTP::serverAccept()
+{
+  uint8_t i,sk;
+  if (millis()-Server.tacc<Server.iacc) return;
+  for (i=0;i<SERVCLIENTS;i++) if (Server.csk[i]==0xFF) break;
+  if (i==SERVCLIENTS) return;              //table full
+  Server.tacc=millis();
+  sk=pollingAccept(Server.ssk);
+  if (sk==0xFF)
+  {
+    Server.iacc=Server.iacc*2;
+    if (Server.iacc<ACCEPTMIN) Server.iacc=ACCEPTMIN;
+    if (Server.iacc>ACCEPTMAX) Server.iacc=ACCEPTMAX;
+    return;
+  }
+  Server.csk[i]=sk;Server.tlast[i]=millis();Server.nreq[i]=0;
+  Server.iacc=0;
 }
 
 /*
 *  Sends page stored as prog_char array in PROGMEM  
+*  Length is known: one Content-Length response (no chunks), in frames of 
+*  MAXFRAME bytes.
 */	
 void HTTP::sendResponse(int sk,prog_char *page)
 {
   if (page==NULL) {respERR(sk);return;}
-  int len=strlen_P(page);
-  int pos=0,lp=0;
-  startLongResponse(sk);
-  while(pos<len)
-  {lp=len-pos;if (lp>MAXC) lp=MAXC;sendChunkResponse(sk,page+pos,lp,NULL);pos=pos+lp;}
-	endLongResponse(sk);
+  sendResponse(sk,&page,1);
 }
 
 /*
@@ -120,19 +300,13 @@ void HTTP::sendResponse(int sk,prog_char *page)
 */
 void HTTP::sendResponse(int sk,prog_char* amodule[],uint8_t nm)
 {
+  int k,n;
+  long len=0;
   if (amodule==NULL) {respERR(sk);return;}
-  startLongResponse(sk);
-  int k;
-  for (k=0;k<nm;k++)
-  {
-   prog_char* page=amodule[k];
-   if (page==NULL){endLongResponse(sk);return;} 
-   int len=strlen_P(page);
-   int pos=0,lp=0;
-   while(pos<len)
-   {lp=len-pos;if (lp>MAXC) lp=MAXC;sendChunkResponse(sk,page+pos,lp,NULL);pos=pos+lp;}
-  }
-	endLongResponse(sk);
+  for (n=0;(n<nm)&&(amodule[n]!=NULL);n++) len=len+strlen_P(amodule[n]);
+  wrLenHead(sk,len);
+  for (k=0;k<n;k++) wrPut(amodule[k],strlen_P(amodule[k]),true);   //measured again: no stack array
+  wrEnd();
 }
 
 /*
@@ -143,29 +317,9 @@ void HTTP::sendResponse(int sk,prog_char* amodule[],uint8_t nm)
 */	
 void HTTP::sendDynResponse(int sk,prog_char page[],int npar,char *param[])
 {
-	int len=strlen_P(page);
-  int i,lp=0,np=0,pos=0;
-	char c;
-	if ((param==NULL)|(npar<=0)) {sendResponse(sk,page);return;}
-	startLongResponse(sk);
-	while(pos<len)
-	{
-		 lp=0;
-		 for(i=pos;i<len;i++)
-     {
-			 lp++;c=pgm_read_byte(page+i);
-       if (c=='@')
-			 {
-				 if ((np<npar)&(param[np]!=NULL))
-           {sendChunkResponse(sk,page+pos,lp,param[np]);np++;break;}
-				 else np++;
-			 }
-   		 if ((lp>=MAXC)&(c!='@')) {sendChunkResponse(sk,page+pos,lp,NULL);break;}
-			 if (i==len-1)sendChunkResponse(sk,page+pos,lp,NULL); 
-		 }
-		 pos=pos+lp;
-  }
-	endLongResponse(sk);
+	if (page==NULL) {respERR(sk);return;}
+	if ((param==NULL)||(npar<=0)) {sendResponse(sk,page);return;}
+	sendPage(sk,page,npar,param,PAGEHEAD|PAGELAST);
 }
 
 /*
@@ -174,37 +328,269 @@ void HTTP::sendDynResponse(int sk,prog_char page[],int npar,char *param[])
 */
 void HTTP::sendDynResponse(int sk,prog_char* amodule[],uint8_t nm,int npar,char *param[])
 {
+  int k,n;
   if (amodule==NULL) {respERR(sk);return;}
-  if ((param==NULL)|(npar<=0)) {sendResponse(sk,amodule,nm);return;}
-  startLongResponse(sk);
-  int k;
-  for (k=0;k<nm;k++)
-  {
-    prog_char* page=amodule[k];
-    if (page==NULL){endLongResponse(sk);return;} 
-    int len=strlen_P(page);
-    int i,lp=0,np=0,pos=0;
-	  char c;
-	  if ((param==NULL)|(npar<=0)) {sendResponse(sk,page);return;}
-  	while(pos<len)
-	  {
-		 lp=0;
-		 for(i=pos;i<len;i++)
-     {
-			 lp++;c=pgm_read_byte(page+i);
-       if (c=='@')
-			 {
-				 if ((np<npar)&(param[np]!=NULL))
-           {sendChunkResponse(sk,page+pos,lp,param[np]);np++;break;}
-				 else np++;
-			 }
-   		 if ((lp>=MAXC)&(c!='@')) {sendChunkResponse(sk,page+pos,lp,NULL);break;}
-			 if (i==len-1)sendChunkResponse(sk,page+pos,lp,NULL); 
-		 }
-		 pos=pos+lp;
+  if ((param==NULL)||(npar<=0)) {sendResponse(sk,amodule,nm);return;}
+  for (n=0;(n<nm)&&(amodule[n]!=NULL);n++);
+  if (n==0) {startLongResponse(sk);endLongResponse(sk);return;}
+  for (k=0;k<n;k++) 
+    sendPage(sk,amodule[k],npar,param,(k==0?PAGEHEAD:0)|(k==n-1?PAGELAST:0));
+}
+
+/*
+* Chunked response of one page (or module): tags substituted (param[] from 0
+* for each module). ends: PAGEHEAD header in first frame, PAGELAST last chunk
+* in last frame.
+*/
+void HTTP::sendPage(int sk,prog_char *page,int npar,char *param[],uint8_t ends)
+{
+  int pos=0,np=0;
+  while (pageFrame(sk,page,&pos,&np,npar,param,&ends)>0) receiveMessWait(30000);
+}
+
+/*
+* One frame of chunked page from pos (np next param): as many chunks (MAXC 
+* bytes max each) as fit in MAXFRAME bytes, with header and last chunk if 
+* still to be sent (ends). Chunks are measured before frame is started.
+* Returns frame length (0 if nothing left); answer to be received.
+*/
+int HTTP::pageFrame(int sk,prog_char *page,int *pos,int *np,int npar,char *param[],uint8_t *ends)
+{
+  int len=strlen_P(page);
+  int lp,lc,lf=0,fpos=*pos,fnp=*np,snp;
+  bool last;
+  char *spar;
+  if (Resource.method==HPHEAD)                     //header only
+  {
+    if (!(*ends&PAGEHEAD)) return 0;
+    *ends=0;
+    putLongHead(sk);
+    return headLen()+strlen_P(rchunked);
+  }
+  if (param==NULL) npar=0;
+  if (*ends&PAGEHEAD) lf=headLen()+strlen_P(rchunked);
+  while (fpos<len)
+  {
+    snp=fnp;
+    lp=dynChunk(page,len,fpos,&fnp,npar,param,&spar);
+    lc=chunkLen(lp,spar);
+    if ((lf>0)&&(lf+lc>MAXFRAME)) {fnp=snp;break;}
+    lf=lf+lc;fpos=fpos+lp;
+  }
+  last=(fpos>=len)&&(*ends&PAGELAST)&&(lf+5<=MAXFRAME);
+  if (last) lf=lf+5;
+  if (lf==0) return 0;
+  beginData(sk,lf);
+  if (*ends&PAGEHEAD) {putHead();putDataPM(rchunked,strlen_P(rchunked));}
+  while (*pos<fpos)
+  {
+    lp=dynChunk(page,len,*pos,np,npar,param,&spar);
+    putChunk(page+*pos,lp,spar);
+    *pos=*pos+lp;
+  }
+  if (last) putData((uint8_t*)"0\r\n\r\n",5);
+  endData();
+  *ends=last?0:(*ends&PAGELAST);
+  return lf;
+}
+
+/*
+* Compiled page: length known, one Content-Length response.
+*/
+void HTTP::sendDynResponse(int sk,const DYNPAGE *pg,int npar,char *param[])
+{
+  if (pg==NULL) {respERR(sk);return;}
+  prog_char *text=(prog_char*)pgm_read_word(&pg->text);
+  const uint16_t *segs=(const uint16_t*)pgm_read_word(&pg->segs);
+  uint8_t i,nseg=pgm_read_byte(&pg->nseg);
+  uint16_t pos=0,end;
+  long len=pgm_read_word(&pg->ltext);
+  uint32_t etag=pgm_read_dword(&pg->etag);
+  if (etagMatch(etag,false))
+  {
+    wrBegin(sk,respHead(ASSETHTML,HFNOTMOD,etag,0,0,false),0);
+    respHead(ASSETHTML,HFNOTMOD,etag,0,0,true);
+    wrEnd();
+    return;
+  }
+  if (param==NULL) npar=0;
+  for (i=0;i+1<nseg;i++) len=len+(((i<npar)&&(param[i]!=NULL))?strlen(param[i]):1);
+  wrBegin(sk,respHead(ASSETHTML,0,etag,0,len,false),len);
+  respHead(ASSETHTML,0,etag,0,len,true);
+  for (i=0;i<nseg;i++)
+  {
+    end=pgm_read_word(&segs[i]);
+    wrPut(text+pos,end-pos,true);
+    pos=end;
+    if (i+1==nseg) break;
+    if ((i<npar)&&(param[i]!=NULL)) wrPut(param[i],strlen(param[i]),false);
+    else wrPut("@",1,false);
+  }
+  wrEnd();
+}
+
+/*
+* Static asset (WEBASSET in PROGMEM): gzip content is sent only if request 
+* accepts it (Accept-Encoding), else not compressed content if present, or 
+* 406 answer. If request has its ETag (If-None-Match) only header is sent 
+* (304).
+*/
+void HTTP::sendAsset(int sk,const WEBASSET *a)
+{
+  WEBASSET as;
+  uint8_t hf=0;
+  if (a==NULL) {respERR(sk);return;}
+  memcpy_P(&as,a,sizeof(WEBASSET));
+  if (as.flags&ASSETGZIP)
+  {
+    hf=HFVARY;
+    if (Parser.flags&HPGZIP) hf|=HFGZIP;
+  }
+  if (etagMatch(as.etag,hf&HFGZIP)) {as.len=0;hf|=HFNOTMOD;}
+  else if ((as.flags&ASSETGZIP)&&!(hf&HFGZIP))
+  {
+    if (as.plain==NULL) {respCode(sk,406);return;}
+    as.data=as.plain;as.len=as.lplain;
+  }
+  wrBegin(sk,respHead(as.type,hf,as.etag,as.maxage,as.len,false),as.len);
+  respHead(as.type,hf,as.etag,as.maxage,as.len,true);
+  wrPut(as.data,as.len,true);
+  wrEnd();
+}
+
+/*
+* True if request If-None-Match has etag (gzip version if gz) or "*".
+*/
+bool HTTP::etagMatch(uint32_t etag,bool gz)
+{
+  char tag[16];
+  if ((etag==0)||(Resource.inm[0]=='\0')) return false;
+  if (strcmp(Resource.inm,"*")==0) return true;
+  snprintf(tag,16,gz?"\"%08lx-gz\"":"\"%08lx\"",(unsigned long)etag);
+  return (strstr(Resource.inm,tag)!=NULL);
+}
+
+/*
+* Header of Content-Length response (len body length), of chunked response
+* (HFCHUNKED) or of 304 answer (HFNOTMOD): returns its length and writes it 
+* (wrPut) if put.
+* type: ASSETHTML...; hf: HFGZIP, HFVARY, HFNOTMOD, HFCHUNKED; etag (0: 
+* none); maxage seconds of client cache (0: no-cache).
+*/
+int HTTP::respHead(uint8_t type,uint8_t hf,uint32_t etag,uint32_t maxage,long len,bool put)
+{
+  int n=0;
+  char b[20];
+  prog_char *p;
+  if (type>=sizeof(assetTypes)/sizeof(PGM_P)) type=ASSETBIN;
+  p=(hf&HFNOTMOD)?r304:rok;
+  n+=hpart(p,strlen_P(p),true,put);
+  n+=hpart(hserver,strlen_P(hserver),true,put);
+  if (!(hf&HFNOTMOD))
+  {
+    n+=hpart(hctype,strlen_P(hctype),true,put);
+    p=(prog_char*)pgm_read_word(&assetTypes[type]);
+    n+=hpart(p,strlen_P(p),true,put);
+    n+=hpart(crlf,2,true,put);
+    if (hf&HFGZIP) n+=hpart(hgzip,strlen_P(hgzip),true,put);
+  }
+  if (hf&HFVARY) n+=hpart(hvary,strlen_P(hvary),true,put);
+  if (etag!=0) 
+  {
+    n+=hpart(hetag,strlen_P(hetag),true,put);
+    n+=hpart(b,snprintf(b,20,(hf&HFGZIP)?"\"%08lx-gz\"\r\n":"\"%08lx\"\r\n",
+                        (unsigned long)etag),false,put);
+  }
+  if (maxage>0)
+  {
+    n+=hpart(hmaxage,strlen_P(hmaxage),true,put);
+    n+=hpart(b,snprintf(b,20,"%lu\r\n",(unsigned long)maxage),false,put);
+  }
+  else n+=hpart(hnocache,strlen_P(hnocache),true,put);
+  p=Resource.keep?hkeep:hclose;
+  n+=hpart(p,strlen_P(p),true,put);
+  if (hf&HFCHUNKED) return n+hpart(rchunked,strlen_P(rchunked),true,put);
+  if (!(hf&HFNOTMOD))
+  {
+    n+=hpart(headerLen,strlen_P(headerLen),true,put);
+    n+=hpart(b,snprintf(b,20,"%ld\r\n",len),false,put);
+  }
+  n+=hpart(crlf,2,true,put);
+  return n;
+}
+
+int HTTP::hpart(const void *p,int len,bool pm,bool put)
+{
+  if (put) wrPut(p,len,pm);
+  return len;
+}
+
+/*
+* Response writer: header (hlen) and body (blen) bytes sent in frames of 
+* MAXFRAME max; each frame answer is received before next frame.
+* Body is dropped for HEAD request.
+*/
+void HTTP::wrBegin(int sk,int hlen,long blen)
+{
+  wsk=sk;wfree=0;wopen=false;wsent=0;
+  wleft=(Resource.method==HPHEAD)?hlen:hlen+blen;
+}
+
+/*
+* Response header (html page) with Content-Length (len of body) as start of 
+* response written by wrPut.
+*/
+void HTTP::wrLenHead(int sk,long len)
+{
+  wrBegin(sk,respHead(ASSETHTML,0,0,0,len,false),len);
+  respHead(ASSETHTML,0,0,0,len,true);
+}
+
+void HTTP::wrPut(const void *data,long len,bool pm)
+{
+  uint16_t n;
+  uint8_t *d=(uint8_t*)data;
+  while ((len>0)&&(wleft>0))
+  {
+    if (wfree==0)
+    {
+      if (wopen) {endData();receiveMessWait(30000);wsent+=dataSent();}
+      wfree=(wleft<MAXFRAME)?wleft:MAXFRAME;
+      beginData(wsk,wfree);wopen=true;
     }
+    n=(len<wfree)?len:wfree;
+    if (pm) putDataPM((prog_char*)d,n); else putData(d,n);
+    d=d+n;len=len-n;wfree=wfree-n;wleft=wleft-n;
+  }
+}
+
+void HTTP::wrEnd()
+{
+  if (wopen) {endData();receiveMessWait(30000);wsent+=dataSent();}
+  wopen=false;
+}
+
+/*
+* Next chunk of dynamic page (len bytes) starting from pos: returns its length
+* (tag included) and sets spar to parameter substituting the tag at its end 
+* (or NULL). np is the next parameter index (updated).
+*/
+int HTTP::dynChunk(prog_char *page,int len,int pos,int *np,int npar,char *param[],char **spar)
+{
+  int i,lp=0;
+  char c;
+  *spar=NULL;
+  for(i=pos;i<len;i++)
+  {
+	 lp++;c=pgm_read_byte(page+i);
+   if (c=='@')
+	 {
+		 if ((*np<npar)&&(param[*np]!=NULL)) {*spar=param[*np];(*np)++;break;}
+		 else (*np)++;
+	 }
+   if ((lp>=MAXC)&(c!='@')) break;
   }
-  endLongResponse(sk);
+  return lp;
 }
 
 /*
@@ -213,12 +599,286 @@ void HTTP::sendDynResponse(int sk,prog_char* amodule[],uint8_t nm,int npar,char
 void HTTP::sendShortResponse(int sk,char *data)
 {
   if (data==NULL) {respERR(sk);return;}
-  int len=strlen(data);
-  char clen[10];snprintf(clen,10,"%d\r\n\r\n",len);
-  writeDataPM(sk,rshort);
-  writeDataPM(sk,headerLen);
-  writeData(sk,clen);
-  writeData(sk,data);
+  RESPBUILD r;
+  respBegin(&r,200,ASSETHTML);
+  respSend(sk,&r,data);
+}
+
+/*
+* Response builder: status line and headers in r->head, sent with body by 
+* respSend (one frame if MAXFRAME is enough).
+*/
+void HTTP::respBegin(RESPBUILD *r,int code,uint8_t type)
+{
+  char b[8];
+  if (type>=sizeof(assetTypes)/sizeof(PGM_P)) type=ASSETBIN;
+  r->code=code;r->len=0;
+  respAdd(r,http11,true);
+  snprintf(b,8,"%d ",code);respAdd(r,b,false);
+  respAdd(r,statusText(code),true);
+  respAdd(r,crlf,true);
+  respAdd(r,hserver,true);
+  respAdd(r,hctype,true);
+  respAdd(r,(prog_char*)pgm_read_word(&assetTypes[type]),true);
+  respAdd(r,crlf,true);
+  respAdd(r,hnocache,true);
+  respAdd(r,Resource.keep?hkeep:hclose,true);
+}
+
+void HTTP::respHeader(RESPBUILD *r,char *name,char *value)
+{
+  respAdd(r,name,false);respAdd(r,": ",false);
+  respAdd(r,value,false);respAdd(r,crlf,true);
+}
+
+void HTTP::respHeaderPM(RESPBUILD *r,prog_char *name,char *value)
+{
+  respAdd(r,name,true);respAdd(r,": ",false);
+  respAdd(r,value,false);respAdd(r,crlf,true);
+}
+
+void HTTP::respSend(int sk,RESPBUILD *r,char *body)
+{
+  respSend(sk,r,(uint8_t*)body,(body==NULL)?0:strlen(body));
+}
+
+/*
+* Headers end (Content-Length, none for 204 and 304) and body: one frame if
+* length <= MAXFRAME. Headers over RESPBUFF: 500 answer.
+*/
+void HTTP::respSend(int sk,RESPBUILD *r,uint8_t *body,int len)
+{
+  char clen[28];
+  int lcl;
+  if (r->len<0) {respERR(sk);return;}
+  if ((r->code==204)||(r->code==304)) {len=0;lcl=snprintf(clen,28,"\r\n");}
+  else lcl=snprintf(clen,28,"Content-Length: %d\r\n\r\n",len);
+  wrBegin(sk,r->len+lcl,len);
+  wrPut(r->head,r->len,false);
+  wrPut(clen,lcl,false);
+  wrPut(body,len,false);
+  wrEnd();
+}
+
+/*
+* Appends string (PROGMEM if pm) to builder headers; len -1 if no room.
+*/
+void HTTP::respAdd(RESPBUILD *r,const char *str,bool pm)
+{
+  int l;
+  if (r->len<0) return;
+  l=pm?strlen_P(str):strlen(str);
+  if (r->len+l>RESPBUFF) {r->len=-1;return;}
+  if (pm) memcpy_P(&r->head[r->len],str,l); else memcpy(&r->head[r->len],str,l);
+  r->len=r->len+l;
+}
+
+/*
+* JSON writer. Header (chunked, application/json) is sent with first chunk.
+*/
+void HTTP::jsonBegin(JSONWRITER *j,int sk)
+{
+  j->sk=sk;j->len=0;j->depth=0;j->skip=0;j->arr=0;j->more=0;j->flags=JWHEAD;
+}
+
+void HTTP::jsonObject(JSONWRITER *j){jsonOpen(j,'{',false);}
+
+void HTTP::jsonArray(JSONWRITER *j){jsonOpen(j,'[',true);}
+
+void HTTP::jsonClose(JSONWRITER *j)
+{
+  uint16_t bit;
+  if (j->skip>0) {j->skip--;return;}           //of an open ignored
+  if (j->depth==0) {j->flags|=JWERR;return;}
+  bit=1<<(j->depth-1);
+  jsonPut(j,(j->arr&bit)?"]":"}",1,false);
+  j->arr&=~bit;j->more&=~bit;j->flags&=~JWKEY;
+  j->depth--;
+}
+
+void HTTP::jsonKey(JSONWRITER *j,char *name)
+{
+  if (!jsonSep(j)) return;
+  jsonQuoted(j,name,false);jsonPut(j,":",1,false);
+  j->flags|=JWKEY;
+}
+
+void HTTP::jsonKeyPM(JSONWRITER *j,prog_char *name)
+{
+  if (!jsonSep(j)) return;
+  jsonQuoted(j,name,true);jsonPut(j,":",1,false);
+  j->flags|=JWKEY;
+}
+
+void HTTP::jsonString(JSONWRITER *j,char *str)
+{
+  if (!jsonSep(j)) return;
+  if (str==NULL) jsonPut(j,"null",4,false); else jsonQuoted(j,str,false);
+}
+
+void HTTP::jsonStringPM(JSONWRITER *j,prog_char *str)
+{
+  if (!jsonSep(j)) return;
+  if (str==NULL) jsonPut(j,"null",4,false); else jsonQuoted(j,str,true);
+}
+
+void HTTP::jsonNumber(JSONWRITER *j,long v)
+{
+  char b[12];
+  if (jsonSep(j)) jsonPut(j,b,snprintf(b,12,"%ld",v),false);
+}
+
+void HTTP::jsonFloat(JSONWRITER *j,double v,uint8_t dec)
+{
+  char b[28];
+  if (!jsonSep(j)) return;
+  if (isnan(v)||isinf(v)||(v>1e15)||(v<-1e15)) {jsonPut(j,"null",4,false);return;}
+  if (dec>7) dec=7;
+  dtostrf(v,1,dec,b);
+  jsonPut(j,b,strlen(b),false);
+}
+
+void HTTP::jsonBool(JSONWRITER *j,bool v)
+{
+  if (!jsonSep(j)) return;
+  if (v) jsonPut(j,"true",4,false); else jsonPut(j,"false",5,false);
+}
+
+void HTTP::jsonNull(JSONWRITER *j){if (jsonSep(j)) jsonPut(j,"null",4,false);}
+
+/*
+* Closes open objects/arrays and sends buffer with last chunk.
+* Returns false if JWERR was set.
+*/
+bool HTTP::jsonEnd(JSONWRITER *j)
+{
+  j->skip=0;
+  while (j->depth>0) jsonClose(j);
+  jsonFlush(j,true);
+  return !(j->flags&JWERR);
+}
+
+/*
+* Object/array deeper than JSONDEPTH: written as null, its content and its
+* close ignored (skip counts the opens ignored).
+*/
+void HTTP::jsonOpen(JSONWRITER *j,char c,bool arr)
+{
+  uint16_t bit;
+  if (j->skip>0) {j->skip++;return;}
+  jsonSep(j);
+  if (j->depth>=JSONDEPTH) {jsonPut(j,"null",4,false);j->skip=1;j->flags|=JWERR;return;}
+  jsonPut(j,&c,1,false);
+  j->depth++;bit=1<<(j->depth-1);
+  if (arr) j->arr|=bit; else j->arr&=~bit;
+  j->more&=~bit;
+}
+
+/*
+* Before a value or key: comma if not first of its object/array (none after
+* a key). Returns false inside an object/array ignored (value dropped).
+*/
+bool HTTP::jsonSep(JSONWRITER *j)
+{
+  uint16_t bit;
+  if (j->skip>0) return false;
+  if (j->flags&JWKEY) {j->flags&=~JWKEY;return true;}
+  if (j->depth==0) return true;
+  bit=1<<(j->depth-1);
+  if (j->more&bit) jsonPut(j,",",1,false);
+  j->more|=bit;
+  return true;
+}
+
+void HTTP::jsonPut(JSONWRITER *j,const char *str,int len,bool pm)
+{
+  int n;
+  while (len>0)
+  {
+    if (j->len==JSONBUFF) jsonFlush(j,false);
+    n=JSONBUFF-j->len;
+    if (n>len) n=len;
+    if (pm) memcpy_P(&j->buff[j->len],str,n); else memcpy(&j->buff[j->len],str,n);
+    j->len=j->len+n;str=str+n;len=len-n;
+  }
+}
+
+/*
+* String with quotes; '"', '\\' and control characters escaped.
+*/
+void HTTP::jsonQuoted(JSONWRITER *j,const char *str,bool pm)
+{
+  char c,e[8];
+  int n;
+  jsonPut(j,"\"",1,false);
+  while ((c=pm?pgm_read_byte(str):*str)!='\0')
+  {
+    str++;
+    n=0;
+    switch (c)
+    {
+      case '"': n=2;e[1]='"';break;
+      case '\\': n=2;e[1]='\\';break;
+      case '\n': n=2;e[1]='n';break;
+      case '\r': n=2;e[1]='r';break;
+      case '\t': n=2;e[1]='t';break;
+      case '\b': n=2;e[1]='b';break;
+      case '\f': n=2;e[1]='f';break;
+      default: if ((uint8_t)c<0x20) n=snprintf(e,8,"\\u%04x",(uint8_t)c);
+    }
+    if (n==2) e[0]='\\';
+    if (n>0) jsonPut(j,e,n,false); else jsonPut(j,&c,1,false);
+  }
+  jsonPut(j,"\"",1,false);
+}
+
+/*
+* Buffer as one chunk frame: header before it if still to be sent, last 
+* chunk after it if last. HEAD request: header only.
+*/
+void HTTP::jsonFlush(JSONWRITER *j,bool last)
+{
+  char slen[8];
+  int ls=0,hlen=0;
+  long blen;
+  if (j->len>0) ls=snprintf(slen,8,"%x\r\n",j->len);
+  blen=ls+((j->len>0)?j->len+2:0)+(last?5:0);
+  if (j->flags&JWHEAD) hlen=respHead(ASSETJSON,HFCHUNKED,0,0,0,false);
+  if (hlen+blen==0) return;
+  wrBegin(j->sk,hlen,blen);
+  if (j->flags&JWHEAD) respHead(ASSETJSON,HFCHUNKED,0,0,0,true);
+  j->flags&=~JWHEAD;
+  if (j->len>0)
+  {
+    wrPut(slen,ls,false);wrPut(j->buff,j->len,false);wrPut("\r\n",2,false);
+  }
+  if (last) wrPut("0\r\n\r\n",5,false);
+  wrEnd();
+  j->len=0;
+}
+
+/*
+* Reason phrase of status code (PROGMEM)
+*/
+prog_char* HTTP::statusText(int code)
+{
+  switch (code)
+  {
+    case 200: return s200;
+    case 201: return s201;
+    case 204: return s204;
+    case 304: return s304;
+    case 400: return s400;
+    case 401: return s401;
+    case 403: return s403;
+    case 404: return s404;
+    case 405: return s405;
+    case 409: return s409;
+    case 413: return s413;
+    case 500: return s500;
+    case 503: return s503;
+  }
+  return sNone;
 }
 
 /*
@@ -247,8 +907,7 @@ char* HTTP::codeWebKey(char user[],char psw[])
 void HTTP::sendRequestGET(int sk,char* resource)
 {
   char host[16];getRemoteIP(host);
-  char* headers[1];headers[0]="Host: ";strcat(headers[0],host);
-  sendRequestGET(sk,headers,1,resource);
+  sendRequest(sk,mGET,host,NULL,0,resource,NULL);
 }
 
 /*
@@ -259,15 +918,7 @@ void HTTP::sendRequestGET(int sk,char* resource)
 */
 void HTTP::sendRequestGET(int sk,char* headers[],int nh,char* resource)
 {
-  int lres=strlen(resource);
-	int len=16+lres;
-	writeData(sk,"GET ");
-	writeData(sk,resource);
-	writeDataPM(sk,http);
-	int i=0;
-	for (i=0;i<nh;i++)
-  {writeData(sk,headers[i]);writeData(sk,"\r\n");}
-  writeData(sk,"\r\n\r\n");	
+  sendRequest(sk,mGET,NULL,headers,nh,resource,NULL);
 }
 
 /*
@@ -281,8 +932,7 @@ void HTTP::sendRequestGET(int sk,char* headers[],int nh,char* resource)
 void HTTP::sendRequestPOST(int sk,char* resource,char* data)
 {
   char host[16];getRemoteIP(host);
-  char* headers[1];headers[0]="Host: ";strcat(headers[0],host);
-  sendRequestPOST(sk,headers,1,resource,data);
+  sendRequest(sk,mPOST,host,NULL,0,resource,data);
 }
 
 /*
@@ -293,20 +943,7 @@ void HTTP::sendRequestPOST(int sk,char* resource,char* data)
 */
 void HTTP::sendRequestPOST(int sk,char* headers[],int nh,char* resource,char* data)
 {
-	int lres=strlen(resource);
-	int len=16+lres;
-	writeData(sk,"POST ");
-	writeData(sk,resource);
-	writeDataPM(sk,http);
-	writeDataPM(sk,headerLen);
-	char dlen[10];sprintf(dlen,"%d\r\n",strlen(data));
-	writeData(sk,dlen);
-	int i=0;
-	for (i=0;i<nh;i++)
-  {writeData(sk,headers[i]);writeData(sk,"\r\n");}
-	writeData(sk,"\r\n");
-	writeData(sk,data);
-	writeData(sk,"\r\n\r\n");
+  sendRequest(sk,mPOST,NULL,headers,nh,resource,data);
 }
 
 /*
@@ -316,8 +953,7 @@ void HTTP::sendRequestPOST(int sk,char* headers[],int nh,char* resource,char* da
 void HTTP::sendRequestPUT(int sk,char* resource,char* data)
 {
   char host[16];getRemoteIP(host);
-  char* headers[1];headers[0]="Host: ";strcat(headers[0],host);
-  sendRequestPUT(sk,headers,1,resource,data);
+  sendRequest(sk,mPUT,host,NULL,0,resource,data);
 }
 
 /*
@@ -325,21 +961,7 @@ void HTTP::sendRequestPUT(int sk,char* resource,char* data)
 */
 void HTTP::sendRequestPUT(int sk,char* headers[],int nh,char* resource,char* data)
 {
-	int lres=strlen(resource);
-	int len=16+lres;
-	writeData(sk,"PUT ");
-	writeData(sk,resource);
-	writeDataPM(sk,http);
-	writeDataPM(sk,headerLen);
-	char dlen[10];sprintf(dlen,"%d\r\n",strlen(data));
-	writeData(sk,dlen);
-	int i=0;
-	for (i=0;i<nh;i++)
-  {writeData(sk,headers[i]);writeData(sk,"\r\n");}
-	writeData(sk,"\r\n");
-	writeData(sk,data);
-	writeData(sk,"\r\n\r\n");
-//	writeData(sk,"\r\n");
+  sendRequest(sk,mPUT,NULL,headers,nh,resource,data);
 }
 
 /*
@@ -348,8 +970,7 @@ void HTTP::sendRequestPUT(int sk,char* headers[],int nh,char* resource,char* dat
 void HTTP::sendRequestDELETE(int sk,char* resource)
 {
   char host[16];getRemoteIP(host);
-  char* headers[1];headers[0]="Host: ";strcat(headers[0],host);
-  sendRequestGET(sk,headers,1,resource);
+  sendRequest(sk,mDELETE,host,NULL,0,resource,NULL);
 }
 
 /*
@@ -360,15 +981,180 @@ void HTTP::sendRequestDELETE(int sk,char* resource)
 */
 void HTTP::sendRequestDELETE(int sk,char* headers[],int nh,char* resource)
 {
-  int lres=strlen(resource);
-	int len=16+lres;
-	writeData(sk,"DELETE ");
-	writeData(sk,resource);
-	writeDataPM(sk,http);
-	int i=0;
-	for (i=0;i<nh;i++)
-  {writeData(sk,headers[i]);writeData(sk,"\r\n");}
-  writeData(sk,"\r\n\r\n");	
+  sendRequest(sk,mDELETE,NULL,headers,nh,resource,NULL);
+}
+
+/*
+*  Request builder: length measured first, then request written by the 
+*  response writer in frames of MAXFRAME (one cmd 116 if it is shorter),
+*  without buffer. Request line, Host (if host not NULL), headers (each 
+*  followed by CRLF), Content-Length if data, empty line and data (nothing 
+*  after it, so the link can be kept).
+*  Returns false if not all bytes were sent (link lost).
+*/
+bool HTTP::sendRequest(int sk,prog_char *method,char *host,char* headers[],int nh,char* resource,char* data)
+{
+  long dlen=(data==NULL)?-1:strlen(data);
+  int len=reqHead(method,host,headers,nh,resource,dlen,false);
+  if (dlen>0) len+=dlen;
+  wrBegin(sk,len,0);
+  reqHead(method,host,headers,nh,resource,dlen,true);
+  if (dlen>0) wrPut(data,dlen,false);
+  wrEnd();
+  return (wsent==len);
+}
+
+/*
+*  Request header (see sendRequest): returns its length, written if put
+*  (dlen: Content-Length, not written if negative).
+*/
+int HTTP::reqHead(prog_char *method,char *host,char* headers[],int nh,char* resource,long dlen,bool put)
+{
+  int i,n;
+  char num[12];
+  n=hpart(method,strlen_P(method),true,put);
+  n+=hpart(resource,strlen(resource),false,put);
+  n+=hpart(http,strlen_P(http),true,put);
+  if (host!=NULL)
+  {
+    n+=hpart(headerHost,strlen_P(headerHost),true,put);
+    n+=hpart(host,strlen(host),false,put);
+    n+=hpart(crlf,2,true,put);
+  }
+  for (i=0;i<nh;i++)
+  {
+    n+=hpart(headers[i],strlen(headers[i]),false,put);
+    n+=hpart(crlf,2,true,put);
+  }
+  if (dlen>=0)
+  {
+    sprintf(num,"%ld",dlen);
+    n+=hpart(headerLen,strlen_P(headerLen),true,put);
+    n+=hpart(num,strlen(num),false,put);
+    n+=hpart(crlf,2,true,put);
+  }
+  n+=hpart(crlf,2,true,put);
+  return n;
+}
+
+/************ Client session */
+
+/*
+*  Session with server ip:port; link opened by first request.
+*/
+void HTTP::sessionBegin(HTTPSESSION *s,char *ip,uint16_t port)
+{
+  strlcpy(s->ip,ip,16);
+  s->port=port;
+  s->sk=0xFF;s->keep=false;s->nreq=0;s->tlast=0;
+}
+
+/*
+*  Request on session link (opened again if closed by server, not kept, 
+*  idle over SESSIDLE or lost). If a kept link gives no answer, the request
+*  is sent once more on a new link. Returns status code (Response filled, 
+*  body to be read), 0 no answer, -1 not valid answer, -2 no link.
+*/
+int HTTP::sessionRequest(HTTPSESSION *s,uint8_t method,char *resource,char *data,int timeout)
+{
+  int code=0;
+  uint8_t i,link;
+  bool sent;
+  for (i=0;i<2;i++)
+  {
+    link=sessionLink(s);
+    if (link==0) return -2;
+    sent=sessionSend(s,method,resource,data);
+    code=sent?getResponseHead(s->sk,timeout):0;
+    if (code>0) break;
+    sessionEnd(s);
+    if (link==1) break;                          //new link: no retry
+    if (sent&&!(method&(HPGET|HPDELETE))) break; //server may have done it
+  }
+  if (code>0) {s->keep=Response.keep;s->tlast=millis();}
+  return code;
+}
+
+/*
+*  Pipelined requests on session link: up to PIPEMAX requests are sent 
+*  before reading their responses, in order. Returns requests answered.
+*/
+int HTTP::sessionBatch(HTTPSESSION *s,uint8_t method,char *resource,char *data[],int n,void (*fun)(int i,int code),int timeout)
+{
+  int code,sent=0,done=0,answered=0;
+  uint8_t link,retry=1;
+  uint8_t b[16];
+  bool wfail;
+  link=sessionLink(s);
+  while ((link!=0)&&(done<n))
+  {
+    wfail=false;
+    while ((sent<n)&&(sent-done<PIPEMAX))
+    {
+      if (!sessionSend(s,method,resource,(data==NULL)?NULL:data[sent])) {wfail=true;break;}
+      sent++;
+    }
+    code=(sent>done)?getResponseHead(s->sk,timeout):0;
+    if (code<=0)                                 //link lost or no answer
+    {
+      sessionEnd(s);
+      if ((link==1)||(answered>0)||(retry==0)) break;
+      if (!(wfail&&(sent==done))&&!(method&(HPGET|HPDELETE))) break;  //server may have done them
+      retry=0;                                   //kept link: once on a new one
+      link=sessionLink(s);answered=0;sent=done;
+      continue;
+    }
+    if (fun!=NULL) fun(done,code);
+    getResponseBody(s->sk,NULL,b,16);            //body not read by fun
+    done++;answered++;
+    s->keep=Response.keep;s->tlast=millis();
+    if (!s->keep&&(done<n))                      //server closes: rest on new link
+      {sessionEnd(s);link=sessionLink(s);answered=0;sent=done;}
+  }
+  return done;
+}
+
+/*
+*  Link of session ready: closed if not kept or idle over SESSIDLE, opened if
+*  needed. Returns 0 if it can't be opened, 1 new link, 2 link reused.
+*/
+uint8_t HTTP::sessionLink(HTTPSESSION *s)
+{
+  if ((s->sk!=0xFF)&&(!s->keep||(millis()-s->tlast>SESSIDLE))) sessionEnd(s);
+  if (s->sk!=0xFF) return 2;
+  s->sk=openSockTCP(s->ip,s->port);
+  if (s->sk==0xFF) return 0;
+  s->nreq=0;s->keep=true;s->tlast=millis();
+  return 1;
+}
+
+/*
+*  Request on session link with Host (ip:port if port is not 80) and 
+*  Connection: keep-alive headers
+*/
+bool HTTP::sessionSend(HTTPSESSION *s,uint8_t method,char *resource,char *data)
+{
+  char host[22];
+  char *headers[1];
+  prog_char *m;
+  switch (method)
+  {
+    case HPPOST: m=mPOST;break;
+    case HPPUT: m=mPUT;break;
+    case HPDELETE: m=mDELETE;break;
+    default: m=mGET;
+  }
+  if (s->port==80) strcpy(host,s->ip);
+  else snprintf(host,22,"%s:%u",s->ip,s->port);
+  headers[0]=hkeepreq;
+  s->nreq++;
+  return sendRequest(s->sk,m,host,headers,1,resource,data);
+}
+
+void HTTP::sessionEnd(HTTPSESSION *s)
+{
+  if (s->sk!=0xFF) closeSock(s->sk);
+  s->sk=0xFF;s->keep=false;
 }
 
 /******** Response
@@ -386,32 +1172,17 @@ char* HTTP::getResponse(int sk){return getResponse(sk,0);}
 */
 char* HTTP::getResponse(int sk,int timeout)
 {
-	int len;
-	char* line;
-  int i;
-  for(i=-1;i<timeout;i=i+10){line=readLine(sk);if(line!=NULL) break;delay(10);}
-	if (line==NULL) return NULL;
-	if (memcmp(line,"HTTP/1.1",8)!=0) 
-        {strcpy(respmess,"ERR");cleanBuff(sk);return "Err!";}
-	strncpy(respmess,(line+9),3);
-	if (memcmp(line,"HTTP/1.1 200",12)!=0)  {cleanBuff(sk);return NOPAGE;} 
-	while (line!=NULL)
-	{
-		line=readLine(sk);
-		if (line!=NULL) 
-		{
-		  char *param=checkHeader(line,headerLen); 
-      if (param!=NULL) sscanf(param,"%i",&len);  
-			if (strlen(line)<2) {break;}
-		}
-	}
-	readLine(sk);
-	char* p=strchr(linebuff,'\0');*p='\n';
-	if (len>LINEBUFFLEN) len=LINEBUFFLEN;
-  linebuff[len]='\0';
+  uint8_t b[LINEBUFFLEN];
+  int n,code=getResponseHead(sk,timeout);
+  if (code==0) return NULL;
+  if (code<0) {strcpy(respmess,"ERR");resetBuff();return "Err!";}
+  if (code!=200) {bodySkip(sk);return NOPAGE;}
+  n=bodyWait(sk,b,LINEBUFFLEN-1,RESPTOUT);
+  bodySkip(sk);                                 //body over LINEBUFFLEN-1
   resetBuff();
-  uint8_t tmp[8];while (readData(sk,tmp,8)>0);
-	return linebuff;
+  memcpy(linebuff,b,n);
+  linebuff[n]='\0';
+  return linebuff;
 }
 
 /*
@@ -430,30 +1201,11 @@ unsigned int HTTP::getResponse(int sk,uint8_t rbuff[],int rbufflen)
 */
 unsigned int HTTP::getResponse(int sk,uint8_t rbuff[],int rbufflen,int timeout)
 {
-	int len;
-	char* line;
-  int i;
-  for(i=-1;i<timeout;i=i+10){line=readLine(sk);if(line!=NULL) break;delay(10);}
-	if (line==NULL) return -1;
-	if (memcmp(line,"HTTP/1.1",8)!=0) 
-        {strcpy(respmess,"ERR");cleanBuff(sk);return -2;}
-	strncpy(respmess,(line+9),3);	
-	if (line==NULL) return -1;
-	if (memcmp(line,"HTTP/1.1 200",12)!=0) {cleanBuff(sk);return -2;} 
-	while (line!=NULL)
-	{
-		line=readLine(sk);
-		if (line!=NULL) 
-		{
-		  char *param=checkHeader(line,headerLen); 
-      if (param!=NULL) sscanf(param,"%i",&len);  
-			if (strlen(line)<2) {break;}
-		}
-	}
-  resetBuff();
-  if (len==0) return 0;
-  uint16_t nb=readData(sk,rbuff,rbufflen);
-	return nb;
+  int code=getResponseHead(sk,timeout);
+  if (code==0) return -1;
+  if (code<0) {strcpy(respmess,"ERR");resetBuff();return -2;}
+  if (code!=200) {bodySkip(sk);return -2;}
+  return bodyWait(sk,rbuff,rbufflen,RESPTOUT);
 }
 
 /*
@@ -463,8 +1215,203 @@ unsigned int HTTP::getResponse(int sk,uint8_t rbuff[],int rbufflen,int timeout)
 */
 unsigned int HTTP::getNextResponseBuffer(int sk,uint8_t rbuff[],int rbufflen)
 {
-   uint16_t nb=readData(sk,rbuff,rbufflen); 
-   return nb;
+  return bodyWait(sk,rbuff,rbufflen,RESPTOUT);
+}
+
+/*
+*   True when all the body of last response has been read.
+*/
+bool HTTP::responseEnd()
+{
+  return (rstate>=RB_END);
+}
+
+/*
+*   Status line and headers of response (Parser) in Response; first byte 
+*   waited timeout millisec, the others RESPTOUT. Informational answers 
+*   (1xx) are skipped.
+*/
+int HTTP::getResponseHead(int sk,int timeout)
+{
+  int n,used,r=HPMORE;
+  uint8_t *data;
+  unsigned long t=millis();
+  unsigned long tmax=(unsigned long)timeout+RESPTOUT;   //no int overflow
+  rstate=RB_END;
+  Response.code=0;Response.clen=-1;Response.left=0;Response.received=0;
+  Response.chunked=false;Response.keep=false;
+  Parser.beginResponse();
+  Parser.watch(headerCType,Response.ctype,CTYPELEN);
+  while (r==HPMORE)
+  {
+    data=dataBuffered(sk,&n);
+    if (n==0)
+    {
+      if (!Parser.started()&&(millis()-t>=(unsigned long)timeout)) return 0;
+      if (millis()-t>tmax) return -1;
+      pause(10,tmax-(millis()-t));
+      continue;
+    }
+    r=Parser.parse(data,n,&used);
+    dataConsumed(used);
+    if ((r==HPDONE)&&(Parser.code/100==1))
+      {Parser.beginResponse();Parser.watch(headerCType,Response.ctype,CTYPELEN);r=HPMORE;}
+  }
+  if (r!=HPDONE) {Response.code=-1;return -1;}
+  snprintf(respmess,4,"%d",Parser.code);
+  Response.code=Parser.code;
+  Response.clen=Parser.clen;
+  Response.chunked=(Parser.flags&HPCHUNKED)!=0;
+  Response.keep=!(Parser.flags&HPCLOSE)&&((Parser.version==11)||(Parser.flags&HPKEEP));
+  rleft=Parser.clen;rline=0;
+  if ((Parser.code==204)||(Parser.code==304)||(rleft==0)) rstate=RB_END;
+  else if (Response.chunked) {rstate=RB_SIZE;rleft=0;}
+  else rstate=RB_BODY;                          //rleft -1: until link closed
+  Response.left=(rstate==RB_BODY)?rleft:((rstate==RB_END)?0:-1);
+  return Parser.code;
+}
+
+/*
+*   Next segment of response body (after getResponseHead) in buff.
+*/
+int HTTP::readResponse(int sk,uint8_t *buff,int lbuff)
+{
+  return bodyWait(sk,buff,lbuff,RESPTOUT);
+}
+
+/*
+*   Response body given to fun a segment (max lbuff bytes of buff) at a time;
+*   fun NULL: body dropped.
+*/
+long HTTP::getResponseBody(int sk,void (*fun)(uint8_t *data,int len),uint8_t *buff,int lbuff)
+{
+  int n;
+  while ((n=bodyWait(sk,buff,lbuff,RESPTOUT))>0) if (fun!=NULL) fun(buff,n);
+  if ((rstate==RB_BODY)&&(rleft<0))            //body until link close: MCW 
+    {rstate=RB_END;Response.left=0;Response.keep=false;}   //reads nothing, as when idle
+  if (rstate!=RB_END) return -1;               //timeout or bad chunks
+  return Response.received;
+}
+
+/*
+*   Body bytes of response already received (max lbuff): Content-Length 
+*   body, or chunked body decoded (size lines, chunk ends and trailers 
+*   dropped). Bytes after the body stay in linebuff.
+*/
+int HTTP::bodyRead(int sk,uint8_t *buff,int lbuff)
+{
+  int n=0,len,i,k;
+  uint8_t *d;
+  while ((n<lbuff)&&(rstate<RB_END))
+  {
+    d=dataBuffered(sk,&len);
+    if (len==0) break;
+    for (i=0;(i<len)&&(n<lbuff)&&(rstate<RB_END);)
+    {
+      if ((rstate==RB_BODY)||(rstate==RB_DATA))
+      {
+        k=len-i;
+        if (k>lbuff-n) k=lbuff-n;
+        if ((rleft>=0)&&(k>rleft)) k=rleft;
+        memcpy(buff+n,d+i,k);
+        n=n+k;i=i+k;
+        Response.received=Response.received+k;
+        if (rleft<0) continue;
+        rleft=rleft-k;
+        if (rleft==0) rstate=(rstate==RB_BODY)?RB_END:RB_CRLF;
+      }
+      else chunkByte(d[i++]);
+    }
+    dataConsumed(i);
+  }
+  if (rstate>=RB_END) Response.left=0;
+  else if (rstate==RB_BODY) Response.left=rleft;
+  return n;
+}
+
+/*
+*   One byte of chunk size line, chunk end or trailers
+*/
+void HTTP::chunkByte(uint8_t c)
+{
+  switch (rstate)
+  {
+    case RB_SIZE:
+      if (isxdigit(c))
+      {
+        if (rleft>0x7FFFFFL) {rstate=RB_ERR;return;}
+        rleft=(rleft<<4)|(isdigit(c)?c-'0':(tolower(c)-'a'+10));
+        rline++;
+        return;
+      }
+      if ((c==';')||(c==' ')||(c=='\t')) {if (rline>0) rstate=RB_EXT; else rstate=RB_ERR;return;}
+    case RB_EXT:                                   //chunk extensions skipped
+      if (c=='\r') return;
+      if (c!='\n') {if (rstate==RB_SIZE) rstate=RB_ERR;return;}
+      if (rline==0) {rstate=RB_ERR;return;}
+      rline=0;
+      rstate=(rleft==0)?RB_TRAILER:RB_DATA;
+      return;
+    case RB_CRLF:
+      if (c=='\r') return;
+      if (c=='\n') {rstate=RB_SIZE;rleft=0;rline=0;} else rstate=RB_ERR;
+      return;
+    case RB_TRAILER:
+      if (c=='\r') return;
+      if (c!='\n') {rline=1;return;}
+      if (rline==0) rstate=RB_END; else rline=0;
+      return;
+  }
+}
+
+/*
+*   Body read in buff (max lbuff bytes) waiting for next bytes up to timeout
+*   millisec: returns less than lbuff only at body end (see responseEnd) or
+*   timeout.
+*/
+int HTTP::bodyWait(int sk,uint8_t *buff,int lbuff,int timeout)
+{
+  int n=0,k;
+  unsigned long t=millis();
+  while ((n<lbuff)&&(rstate<RB_END))
+  {
+    k=bodyRead(sk,buff+n,lbuff-n);
+    if (k>0) {n=n+k;t=millis();continue;}
+    if (millis()-t>=(unsigned long)timeout) break;
+    pause(10,timeout-(millis()-t));
+  }
+  return n;
+}
+
+/*
+*   Rest of body dropped (without waiting if its end is the link close)
+*/
+void HTTP::bodySkip(int sk)
+{
+  uint8_t b[16];
+  int tout=(rleft<0)&&(rstate==RB_BODY)?0:RESPTOUT;
+  while (bodyWait(sk,b,16,tout)>0);
+}
+
+/*
+*   JSON response parsed in pieces of JSONPIECE bytes. Rest of body (after 
+*   document end or error) is dropped.
+*/
+int HTTP::getResponseJSON(int sk,JSONPARSER *jp,int timeout)
+{
+  uint8_t b[JSONPIECE];
+  int n,r;
+  n=(int)getResponse(sk,b,JSONPIECE,timeout);
+  if (n<0) return n;
+  r=jp->feed(b,n);
+  while ((r==JPMORE)&&!responseEnd())
+  {
+    n=bodyWait(sk,b,JSONPIECE,timeout);
+    if (n==0) break;                            //timeout
+    r=jp->feed(b,n);
+  }
+  bodySkip(sk);
+  return r;
 }
 
 /*
@@ -475,89 +1422,106 @@ char* HTTP::getResponseMessage()
     return respmess;
 }
 
-/********************************************************************************/
+/******************************** Tasks ****************************************/
 
-void HTTP::reqGET(int socket,char *buff,int nres,WEBRES rs[],char *key)
-{
-	char* query=NULL;
-  char* endfield=strchr(&buff[4],'?'); {if (endfield!=NULL) query=endfield+1;}
-	if (endfield==NULL) {endfield=strchr(&buff[4],' ');}
-	if (endfield==NULL) {respNOK(socket);return;}
-	*endfield='\0';
-  strlcpy(Resource.name,&buff[4],URILEN);
-	int lquery=0;
-	if (query!=NULL) 
-	{char* endq=strchr(query,' ');if (endq!=NULL) {*endq='\0';} else *query='\0';}
-	if (query!=NULL) {strlcpy(Resource.query,query,QUERYLEN);}
-	bool fauth=true;
-	if (key!=NULL)
-	{
-	  char *param;
-	  fauth=false;
-	  while (buff!=NULL)
-	  {
-		  buff=readLine(socket);
- #if HTTPDEBUG
-  if (buff!=NULL) Serial.println(buff);
- #endif		  
-		  if (strlen(buff)==0) {query=++buff;buff=NULL;}
-		  if (buff!=NULL) 
-		  {param=checkHeader(buff,headerAuth);
-       if (param!=NULL) fauth=checkUserPsw(param,key);}
-	  }	  
-  }
-	cleanBuff(socket);
- #if HTTPDEBUG
-  Serial.println(Resource.name);
-  Serial.println(Resource.query);
- #endif	
-  if (fauth) activateRes(socket,nres,rs);
-  else respNoAuth(socket);
+/*
+*  Task version of getRequest. It polls socket (every REQPOLL millisec) until 
+*  request data arrive; then the request is served at once (its rest is 
+*  already in MCW buffer) activating call back function.
+*  Result: 1 if a request has been served (see Resource), 0 if not valid.
+*/
+uint8_t HTTP::getRequestTask(WIFITASK *t,int sk,int nres,WEBRES rs[])
+{return getRequestTask(t,sk,nres,rs,NULL);}
+
+uint8_t HTTP::getRequestTask(WIFITASK *t,int sk,int nres,WEBRES rs[],char *key)
+{
+  PT_BEGIN(&t->pt);
+  t->res=0;
+  while(1)
+  {
+    PT_WAIT_UNTIL(&t->pt,lockLink(t));
+    if (lineLeft(sk)>0) break;             //pipelined request already read
+    lineRecvStart(sk);
+    t->t=millis();
+    PT_WAIT_UNTIL(&t->pt,(t->code=pollAnswer(t->t,10000))!=MCWPENDING);
+    dataRecvEnd();
+    if (lineLeft(sk)>0) break;
+    unlockLink(t);
+    t->t=millis();
+    PT_WAIT_UNTIL(&t->pt,millis()-t->t>=REQPOLL);
+  }
+  t->res=(handleRequest(sk,nres,rs,key,true)>0);
+  unlockLink(t);
+  PT_END(&t->pt);
 }
 
-void HTTP::reqPOST(int socket,char *buff,int nres,WEBRES rs[],char *key)
+/*
+*  Task version of sendDynResponse. Page is sent in frames (see pageFrame), 
+*  and other tasks can run while MCW answers. 
+*  page and param[] must be unchanged until end.
+*/
+uint8_t HTTP::sendDynResponseTask(WIFITASK *t,int sk,prog_char *page,int npar,char *param[])
 {
-  char* query=NULL;
-  char* endfield=strchr(&buff[5],' ');
-	if (endfield==NULL) {respNOK(socket);return;}
-	*endfield='\0';
-	strlcpy(Resource.name,&buff[5],URILEN);	
-	char* res=strdup(&buff[5]);
-	int len=0;
-	bool fauth;if (key!=NULL) fauth=false; else fauth=true;
-	char *param;
-	while (buff!=NULL)
-	{
-		buff=readLine(socket);
- #if HTTPDEBUG		
-   Serial.println(buff);
- #endif   
-		if (strcspn(buff,"\r\n")==0) {query=buff+2;buff=NULL;}
-		if (buff!=NULL) 
-		{
-		  if (key!=NULL) 
-       {param=checkHeader(buff,headerAuth);
-        if (param!=NULL) fauth=checkUserPsw(param,key);}
-      param=checkHeader(buff,headerLen); 
-      if (param!=NULL) sscanf(param,"%i",&len);  
-		}
-	}
-	if (len>QUERYLEN-1) len=QUERYLEN-1;
- 	if (query!=NULL)strlcpy(Resource.query,query,len+1);
- #if HTTPDEBUG
-  Serial.println(Resource.name);
-  Serial.println(Resource.query);
- #endif
-  if (fauth) activateRes(socket,nres,rs);
-  else respNoAuth(socket);
+  PT_BEGIN(&t->pt);
+  t->n=0;t->i=0;t->step=PAGEHEAD|PAGELAST;
+  while(1)
+  {
+    PT_WAIT_UNTIL(&t->pt,lockLink(t));
+    t->l=pageFrame(sk,page,&t->n,&t->i,npar,param,&t->step);
+    if (t->l==0) break;
+    t->t=millis();
+    PT_WAIT_UNTIL(&t->pt,(t->code=pollAnswer(t->t,30000))!=MCWPENDING);
+    unlockLink(t);
+  }
+  unlockLink(t);
+  PT_END(&t->pt);
 }
 
-char* HTTP::checkHeader(char *buff, prog_char *header)
+/********************************************************************************/
+
+/*
+*  Reads len bytes of body: first QUERYLEN-1 in Resource.query (if store), 
+*  the rest dropped (so link is ready for next request). 
+*  BODYTOUT millisec max.
+*/
+void HTTP::readBody(int socket,long len,bool store)
 {
-   int i;
-   for (i=0;i<strlen_P(header);i++) 
-      {if (buff[i]!=pgm_read_byte(&header[i])) return NULL;}
-   return &buff[i];
+  int n,q=0;
+  uint8_t skip[16];
+  unsigned long t=millis();
+  while (len>0)
+  {
+    if (store&&(q<QUERYLEN-1)) 
+     {n=readBuffData(socket,(uint8_t*)&Resource.query[q],min(len,QUERYLEN-1-q));q=q+n;}
+    else n=readBuffData(socket,skip,min(len,16));
+    len=len-n;
+    if (n>0) continue;
+    if (millis()-t>BODYTOUT) {Resource.keep=false;break;}
+    pause(10,BODYTOUT-(millis()-t));
+  }
+  if (store) Resource.query[q]='\0';
+}
+
+/*
+*  Error answer (Parser result or 405) and link closing.
+*/
+void HTTP::respCode(int sk,int code)
+{
+  prog_char *st;
+  switch (code)
+  {
+    case HPMETHOD: st=r405;break;
+    case 406: st=r406;break;
+    case HPURILONG: st=r414;break;
+    case HPHEADLONG: st=r431;break;
+    default: st=r400;
+  }
+  Resource.keep=false;
+  beginData(sk,strlen_P(st)+strlen_P(rclose0));
+  putDataPM(st,strlen_P(st));
+  putDataPM(rclose0,strlen_P(rclose0));
+  endData();
+  receiveMessWait(30000);
 }
 
 bool HTTP::checkUserPsw(char *param,char *userpsw)
@@ -590,20 +1554,38 @@ void HTTP::respOKempty(int sk)
 
 void HTTP::startLongResponse(int sk)
 {
-  writeDataPM(sk,rlong);
+  putLongHead(sk);
+  receiveMessWait(30000);
 }
 
-void HTTP::sendChunkResponse(int sk,prog_char data[],int ldata,char* spar)
+/*
+*  Response header: status, server, type, cache and connection (as 
+*  Resource.keep). headLen is its length, putHead writes it in the frame.
+*/
+int HTTP::headLen()
 {
-	int lpar;
-	if (spar==NULL) lpar=0;
-	else {lpar=strlen(spar);ldata--;}
-  int tdata=ldata+lpar;
-  char slen[5];sprintf(slen,"%02x\r\n",tdata);
-  writeData(sk,slen);
-  writeDataPM(sk,data,ldata);
-	if (lpar>0) {writeData(sk,(uint8_t*)spar,lpar);}
-  writeData(sk,"\r\n");
+  return strlen_P(rok)+strlen_P(hserver)+strlen_P(rhead)+
+         strlen_P(Resource.keep?hkeep:hclose);
+}
+
+void HTTP::putHead()
+{
+  prog_char *conn=Resource.keep?hkeep:hclose;
+  putDataPM(rok,strlen_P(rok));
+  putDataPM(hserver,strlen_P(hserver));
+  putDataPM(rhead,strlen_P(rhead));
+  putDataPM(conn,strlen_P(conn));
+}
+
+/*
+*  Header of chunked response as one frame. Answer to be received.
+*/
+void HTTP::putLongHead(int sk)
+{
+  beginData(sk,headLen()+strlen_P(rchunked));
+  putHead();
+  putDataPM(rchunked,strlen_P(rchunked));
+  endData();
 }
 
 void HTTP::endLongResponse(int sk)
@@ -611,6 +1593,31 @@ void HTTP::endLongResponse(int sk)
 	writeData(sk,"0\r\n\r\n");
 }
 
+/*
+* Chunk (size line, data, parameter and CRLF) of ldata bytes of page (tag at
+* end if spar): chunkLen is its length in frame, putChunk writes it.
+*/
+int HTTP::chunkLen(int ldata,char *spar)
+{
+  char slen[8];
+  if (spar!=NULL) ldata=ldata-1+strlen(spar);
+  if (ldata==0) return 0;                    //empty: would be last chunk
+  return snprintf(slen,8,"%x\r\n",ldata)+ldata+2;
+}
+
+void HTTP::putChunk(prog_char data[],int ldata,char* spar)
+{
+	int lpar;
+	if (spar==NULL) lpar=0;
+	else {lpar=strlen(spar);ldata--;}
+  if (ldata+lpar==0) return;
+  char slen[8];int ls=snprintf(slen,8,"%x\r\n",ldata+lpar);
+  putData((uint8_t*)slen,ls);
+  putDataPM(data,ldata);
+  putData((uint8_t*)spar,lpar);
+  putData((uint8_t*)"\r\n",2);
+}
+
 
 void HTTP::activateRes(int sk,int nres,WEBRES rs[])
 {
@@ -624,6 +1631,132 @@ void HTTP::activateRes(int sk,int nres,WEBRES rs[])
 	respNOK(sk);
 }
 
+/*
+*  Route table (see setRoutes)
+*/
+void HTTP::setRoutes(int nrt,const WEBROUTE *rt)
+{
+  setRoutes(nrt,rt,NULL,0);
+}
+
+void HTTP::setRoutes(int nrt,const WEBROUTE *rt,const uint8_t *slots,uint8_t nsl)
+{
+  Routes=rt;nroutes=nrt;
+  if (rt==NULL) nroutes=0;
+  rslots=slots;nslots=(slots==NULL)?0:nsl;
+  rpat=routeSearch(0x10000L);
+}
+
+/*
+*  Hash of route names (as routegen.py): 16 bit djb2 (xor), never 0.
+*/
+uint16_t HTTP::routeHash(char *uri)
+{
+  uint16_t h=5381;
+  while (*uri!='\0') h=((h<<5)+h)^(uint8_t)*uri++;
+  if (h==0) h=1;
+  return h;
+}
+
+/*
+*  First route with hash not less than key (patterns have key 0x10000).
+*/
+int HTTP::routeSearch(long key)
+{
+  int lo=0,hi=nroutes,m;
+  long h;
+  while (lo<hi)
+  {
+    m=(lo+hi)/2;
+    h=pgm_read_word(&Routes[m].hash);
+    if (h==0) h=0x10000L;
+    if (h<key) lo=m+1; else hi=m;
+  }
+  return lo;
+}
+
+void HTTP::activateRoute(int sk)
+{
+  int i;
+  uint16_t h;
+  uint8_t s,mm,rm=Resource.method;
+  bool found=false;
+  if (rm==HPHEAD) rm=HPHEAD|HPGET;                   //HEAD served as GET
+  if (strcmp(Resource.name,"/")==0) strcpy(Resource.name,"/index");
+  Resource.nargs=0;
+  h=routeHash(Resource.name);
+  if (nslots>0) {s=pgm_read_byte(&rslots[h%nslots]);i=(s==0)?rpat:s-1;}
+  else i=routeSearch(h);
+  for (;(i<nroutes)&&(pgm_read_word(&Routes[i].hash)==h);i++)
+  {
+    if (strcmp_P(Resource.name,(prog_char*)pgm_read_word(&Routes[i].name))!=0) continue;
+    found=true;
+    mm=pgm_read_byte(&Routes[i].methods);
+    if ((mm==0)||(mm&rm)) {routeCall(i);return;}
+  }
+  for (i=rpat;i<nroutes;i++)
+  {
+    if (!routeMatch(Resource.name,(prog_char*)pgm_read_word(&Routes[i].name))) continue;
+    found=true;
+    mm=pgm_read_byte(&Routes[i].methods);
+    if ((mm==0)||(mm&rm)) {routeCall(i);return;}
+  }
+  Resource.nargs=0;
+  if (found) respCode(sk,HPMETHOD);
+  else respNOK(sk);
+}
+
+void HTTP::routeCall(int i)
+{
+  void (*fun)(char*)=(void (*)(char*))pgm_read_word(&Routes[i].fun);
+  Resource.qlen=strlen(Resource.query);
+  fun(Resource.query);
+}
+
+/*
+*  Matches uri with pattern (PROGMEM): "+" one segment (not empty), "*" the
+*  rest. Captured parts in Resource.args (null terminated, one after other).
+*/
+bool HTTP::routeMatch(char *uri,prog_char *pat)
+{
+  char c;
+  int la=0,n;
+  Resource.nargs=0;
+  while ((c=pgm_read_byte(pat++))!='\0')
+  {
+    if ((c=='+')||(c=='*'))
+    {
+      if (Resource.nargs>=ROUTEARGS) return false;
+      n=0;
+      while ((*uri!='\0')&&((c=='*')||(*uri!='/')))
+      {
+        if (la>=ROUTEARGLEN-1) return false;
+        Resource.args[la++]=*uri++;n++;
+      }
+      if ((c=='+')&&(n==0)) return false;
+      if (la>=ROUTEARGLEN) return false;         //no room for terminator
+      Resource.args[la++]='\0';
+      Resource.nargs++;
+      continue;
+    }
+    if (c!=*uri) return false;
+    uri++;
+  }
+  return (*uri=='\0');
+}
+
+/*
+*  Part i of path captured by route pattern (NULL if none)
+*/
+char* HTTP::routeArg(uint8_t i)
+{
+  char *a=Resource.args;
+  uint8_t k;
+  if (i>=Resource.nargs) return NULL;
+  for (k=0;k<i;k++) a=a+strlen(a)+1;
+  return a;
+}
+
 /*********************************************************************/
 
 /* 
@@ -114,13 +114,46 @@
 
 #include <MWiFi.h>
 #include <utility/BASE64.h>
-
-#define MAXC 64             //chunk packet length 
+#include <utility/HTTPPARSER.h>
+#include <utility/JSONPARSER.h>
+
+#define MAXC 240            //max chunk length (chunks are packed in frames)
+#define MAXFRAME 500        //max data frame (cmd 116) of responses
+#define PAGEHEAD 1          //pageFrame: response header still to be sent
+#define PAGELAST 2          //pageFrame: last chunk still to be sent
+#define REQPOLL 50          //millisec between request polls (getRequestTask)
+#define SERVCLIENTS 3       //client links served together (see startServer)
+#define ACCEPTMIN 20        //min millisec between accept polls (startServer)
+#define ACCEPTMAX 640       //max millisec between accept polls when idle
+#define CLIENTIDLE 5000     //millisec before closing a link without request
+#define MAXREQS 20          //max requests on the same link (keep-alive)
+#define REQTOUT 2000        //millisec max for receiving request headers
+#define BODYTOUT 2000       //millisec max for receiving request body
+#define RESPTOUT 2000       //millisec max between bytes of response (client)
+#define CTYPELEN 32         //Content-Type of response buffer (client)
+#define SESSIDLE 4000       //millisec idle before session link is opened again
+#define PIPEMAX 4           //max requests waiting for response (sessionBatch)
+#define AUTHLEN 48          //max Authorization header value (with key)
+#define ETAGLEN 24          //If-None-Match buffer (longer values cut)
+#define RESPBUFF 160        //headers buffer of response builder (RESPBUILD)
+#define HFGZIP 1            //respHead: Content-Encoding gzip
+#define HFVARY 2            //respHead: Vary Accept-Encoding
+#define HFNOTMOD 4          //respHead: 304 Not Modified
+#define HFCHUNKED 8         //respHead: chunked (no Content-Length)
+#define JSONBUFF 64         //chunk buffer of JSON writer (JSONWRITER)
+#define JSONDEPTH 16        //max nested objects/arrays of JSON writer
+#define JSONPIECE 32        //pieces of body given to JSON parser (getResponseJSON)
+#define JWHEAD 1            //JSONWRITER flags: header still to be sent
+#define JWKEY 2             //                  key written, value expected
+#define JWERR 4             //                  too deep (null written) or close 
+                            //                  without open
 
 #define RESPERR "NOPAGE"    //response error message when page not found(client)
 
-#define URILEN 15           //resource name buffer length (see struct res) 
+#define URILEN 48           //resource name buffer length (longer path: 414)
 #define QUERYLEN 64         //query buffer length (see struct res))
+#define ROUTEARGS 4         //max path segments captured by a route (+ or *)
+#define ROUTEARGLEN 24      //buffer for captured segments (all together)
 
 
 // WEBRES typedef
@@ -130,6 +163,84 @@ typedef struct rsc
 		void (*fun)(char *querystring);   //calback function name joined
 	} WEBRES;
 
+// DYNPAGE typedef (page compiled by HostTools/pagecompile.py, in PROGMEM)
+typedef struct
+	{
+		prog_char *text;                  //page text without tags
+		const uint16_t *segs;             //end of each text segment (PROGMEM)
+		uint16_t ltext;                   //text length
+		uint8_t nseg;                     //segments (tags+1)
+		uint32_t etag;                    //hash of static page (0: no ETag)
+	} DYNPAGE;
+
+// WEBASSET typedef (static file in PROGMEM, see sendAsset and 
+// HostTools/gzasset.py)
+typedef struct
+	{
+		prog_char *data;                  //content (gzip if ASSETGZIP)
+		uint16_t len;                     //content length
+		prog_char *plain;                 //not compressed content (or NULL)
+		uint16_t lplain;                  //its length
+		uint8_t type;                     //content type: ASSETHTML...
+		uint8_t flags;                    //ASSETGZIP
+		uint32_t etag;                    //content hash (0: no ETag)
+		uint32_t maxage;                  //seconds of client cache (0: no-cache)
+	} WEBASSET;
+
+#define ASSETGZIP 1         //WEBASSET data is gzip compressed
+#define ASSETHTML 0         //WEBASSET content types
+#define ASSETCSS 1
+#define ASSETJS 2
+#define ASSETJSON 3
+#define ASSETTEXT 4
+#define ASSETPNG 5
+#define ASSETJPEG 6
+#define ASSETGIF 7
+#define ASSETICO 8
+#define ASSETSVG 9
+#define ASSETBIN 10
+
+// RESPBUILD typedef (response builder, see respBegin)
+typedef struct
+	{
+		char head[RESPBUFF];              //status line and headers
+		int len;                          //their length (-1: no room)
+		int code;                         //status code
+	} RESPBUILD;
+
+// JSONWRITER typedef (streaming JSON response, see jsonBegin)
+typedef struct
+	{
+		int sk;                           //socket of response
+		char buff[JSONBUFF];              //chunk being filled
+		uint8_t len;                      //its length
+		uint8_t depth;                    //open objects/arrays
+		uint8_t skip;                     //opens ignored (deeper than JSONDEPTH)
+		uint16_t arr;                     //bit per level: array (else object)
+		uint16_t more;                    //bit per level: value written (comma)
+		uint8_t flags;                    //JWHEAD, JWKEY, JWERR
+	} JSONWRITER;
+
+// HTTPSESSION typedef (client link kept between requests, see sessionBegin)
+typedef struct
+	{
+		char ip[16];                      //server address (n.n.n.n)
+		uint16_t port;
+		uint8_t sk;                       //socket of link (0xFF: closed)
+		bool keep;                        //link kept by server after last response
+		uint8_t nreq;                     //requests sent on link
+		unsigned long tlast;              //millis of last response
+	} HTTPSESSION;
+
+// WEBROUTE typedef (route table in PROGMEM, see setRoutes)
+typedef struct
+	{
+		uint16_t hash;                    //routeHash(name); 0 for patterns
+		uint8_t methods;                  //HPGET|HPPOST... (0: any method)
+		prog_char *name;                  //URI (PROGMEM) or pattern
+		void (*fun)(char *querystring);   //calback function name joined
+	} WEBROUTE;
+
 
 
 class HTTP : public MWiFi
@@ -144,7 +255,9 @@ public:
 *  Or send a 404 Not Found message
 *  Returns the resource name request.
 *  N.B. Query string is provided to call back function as argument by this fun. 
-*  Request can be GET or POST
+*  Request can be GET, POST or HEAD (as GET, but library responses send 
+*  header only). Other methods get 405, too long path or headers 414 or 431,
+*  at once (rest of request is not read: close socket)
 */
 	char* getRequest(int socket,int nres,WEBRES rs[]);
 
@@ -155,8 +268,50 @@ public:
 */
   char* getRequest(int socket,int nres,WEBRES rs[],char *key);
 	
+/*
+*  Multi client server. startServer opens listening socket on port (returns 
+*  it or 0xFF). serveRequests (call it at each loop) accepts new links in a
+*  table of SERVCLIENTS sockets (accept is polled less often while nobody 
+*  asks), reads whichever link has a request and serves it as getRequest.
+*  Client socket of current request is Resource.sk (use it in call back 
+*  functions). Links are persistent (HTTP/1.1 keep-alive): a link is closed
+*  when client asks (Connection: close or HTTP/1.0), after MAXREQS requests,
+*  or after CLIENTIDLE millisec without request. Following requests already 
+*  sent by client (pipelining) are served in order.
+*  Returns resource name served, or NULL.
+*  N.B. MCW must have enough server sockets for concurrent links (SRVSOCKS
+*  and BACKLOG in MWiFi.h)
+*/
+  uint8_t startServer(uint16_t port);
+  char* serveRequests(int nres,WEBRES rs[]);
+  char* serveRequests(int nres,WEBRES rs[],char *key);
+  void stopServer();
+
+/*
+*  Route table stored in PROGMEM, used (when set) instead of WEBRES array by
+*  getRequest, serveRequests and getRequestTask (give them 0,NULL as rs).
+*  Entries with exact names have hash=routeHash(name) and are sorted by hash
+*  (binary search: few compares also for many routes, no RAM for names); 
+*  with slots (nsl bytes in PROGMEM, perfect hash made by routegen.py: slot 
+*  hash%nsl has index+1 of first route with that hash, 0 none) a name is
+*  found with one lookup. Pattern entries (hash 0) follow them and are 
+*  tried in order. In patterns 
+*  "+" matches one path segment and a final "*" the rest of the path; 
+*  matched parts are given by routeArg(0..). methods is a mask of HPGET, 
+*  HPPOST, HPPUT, HPDELETE (0 any): a path found only with other methods 
+*  gets 405, a path not found 404.
+*  HostTools/routegen.py makes the table (names, hashes, order) from a 
+*  list of routes.
+*  setRoutes(0,NULL) goes back to WEBRES arrays.
+*/
+  void setRoutes(int nrt,const WEBROUTE *rt);
+  void setRoutes(int nrt,const WEBROUTE *rt,const uint8_t *slots,uint8_t nsl);
+  char* routeArg(uint8_t i);
+  uint16_t routeHash(char *uri);
+
 /*
 *  Sends page stored as prog_char array in PROGMEM  
+*  (as one Content-Length response, also module version)
 */	
 	void sendResponse(int socket,prog_char *page);
 
@@ -180,11 +335,89 @@ public:
 */
   void sendDynResponse(int sk,prog_char* amodule[],uint8_t nm,int npar,char *param[]);
 
+/*
+* Version for compiled pages (DYNPAGE made by HostTools/pagecompile.py): text
+* segments and tag positions are known, so page is not scanned and response
+* has exact Content-Length (no chunks), sent in frames of MAXFRAME bytes.
+* Tags without param (NULL or over npar) are sent as '@'.
+* Static compiled pages (no tags) have ETag: a repeated request gets 304.
+*/
+  void sendDynResponse(int sk,const DYNPAGE *pg,int npar,char *param[]);
+
+/*
+* Sends static file (WEBASSET made by HostTools/gzasset.py) with its content 
+* type and Content-Length. Compressed (gzip) files cross serial link and net
+* in fewer bytes: they are sent with Content-Encoding: gzip if request 
+* accepts it; else not compressed version (if any) or 406 Not Acceptable.
+* With ETag (content hash) a request having it in If-None-Match gets only a
+* 304 header; maxage lets client keep it without asking.
+*/
+  void sendAsset(int sk,const WEBASSET *a);
+
 /*
 * Sends short data as response. Typically used for forms or ajax answering.
 */
   void sendShortResponse(int sk,char *data);
 
+/*
+* Response builder. Status line and headers are assembled in r (RESPBUFF 
+* bytes: a local variable is enough), then respSend sends them with 
+* Content-Length and body as one frame (body over MAXFRAME in more frames).
+* respBegin: status code (reason phrase added) and content type (ASSETHTML, 
+* ASSETJSON ... as WEBASSET); Server, Cache-Control: no-cache and Connection
+* headers are added.
+* respHeader (respHeaderPM: name in PROGMEM): more headers.
+* respSend: body (string, or buffer with length). If headers don't fit in 
+* RESPBUFF, 500 is sent.
+* Example: RESPBUILD r; WIFI.respBegin(&r,201,ASSETJSON); 
+*          WIFI.respHeader(&r,"Location","/item/3"); 
+*          WIFI.respSend(WIFI.Resource.sk,&r,"{\"id\":3}");
+*/
+  void respBegin(RESPBUILD *r,int code,uint8_t type);
+  void respHeader(RESPBUILD *r,char *name,char *value);
+  void respHeaderPM(RESPBUILD *r,prog_char *name,char *value);
+  void respSend(int sk,RESPBUILD *r,char *body);
+  void respSend(int sk,RESPBUILD *r,uint8_t *body,int len);
+
+/*
+* Streaming JSON response (chunked): values are written in the JSONBUFF 
+* bytes of j (a local variable) and each full buffer is sent as a chunk, so 
+* the reply can be much longer than RAM. Header goes with the first chunk, 
+* last chunk with the rest of the buffer when jsonEnd is called.
+* Objects and arrays: jsonObject/jsonArray open, jsonClose closes (up to 
+* JSONDEPTH nested); jsonKey (jsonKeyPM: in PROGMEM) before each object 
+* value. Commas are put by the writer. Strings are escaped; floats with dec 
+* decimals (NaN and infinite as null). jsonEnd closes what is still open.
+* An object/array deeper than JSONDEPTH is written as null (its content and 
+* its jsonClose are ignored) and a jsonClose without open is ignored: then
+* jsonEnd returns false (JSON complete but not as asked).
+* Example: JSONWRITER j; WIFI.jsonBegin(&j,WIFI.Resource.sk);
+*          WIFI.jsonObject(&j); WIFI.jsonKeyPM(&j,kA1);
+*          WIFI.jsonNumber(&j,analogRead(1)); WIFI.jsonEnd(&j);
+*/
+  void jsonBegin(JSONWRITER *j,int sk);
+  void jsonObject(JSONWRITER *j);
+  void jsonArray(JSONWRITER *j);
+  void jsonClose(JSONWRITER *j);
+  void jsonKey(JSONWRITER *j,char *name);
+  void jsonKeyPM(JSONWRITER *j,prog_char *name);
+  void jsonString(JSONWRITER *j,char *str);
+  void jsonStringPM(JSONWRITER *j,prog_char *str);
+  void jsonNumber(JSONWRITER *j,long v);
+  void jsonFloat(JSONWRITER *j,double v,uint8_t dec);
+  void jsonBool(JSONWRITER *j,bool v);
+  void jsonNull(JSONWRITER *j);
+  bool jsonEnd(JSONWRITER *j);
+
+/*
+* Task versions (see Task functions in MWiFi.h) of getRequest and 
+* sendDynResponse. Other tasks can run while these wait for the client or 
+* for MCW answers. getRequestTask result (res): 1 request served.
+*/
+  uint8_t getRequestTask(WIFITASK *t,int sk,int nres,WEBRES rs[]);
+  uint8_t getRequestTask(WIFITASK *t,int sk,int nres,WEBRES rs[],char *key);
+  uint8_t sendDynResponseTask(WIFITASK *t,int sk,prog_char *page,int npar,char *param[]);
+
 /*
 *  It sets the autentication key for controlled access.
 *  The key is the link of usename+':'+password, and is encoded using base64 format.
@@ -253,6 +486,41 @@ public:
 */
   void sendRequestDELETE(int sk,char* headers[],int nh,char* resource);    	
 
+/*
+*  Client session: TCP link to server kept open between requests 
+*  (Connection: keep-alive), so periodic requests don't open a socket each 
+*  time. sessionRequest opens the link when needed (first request, server 
+*  closed it, idle over SESSIDLE) and sends once more on a new link a 
+*  request that could not be written on the old one (GET and DELETE also 
+*  when not answered; POST and PUT not, server may have done them). 
+*  method: HPGET, HPPOST, HPPUT, HPDELETE; data NULL for GET and DELETE.
+*  Returns status code (Response filled: read or drop body on s->sk with 
+*  readResponse/getResponseBody before next request), 0 no answer in 
+*  timeout millisec, -1 not valid answer, -2 link can't be opened.
+*  sessionEnd closes the link.
+*  Example: HTTPSESSION ss; WIFI.sessionBegin(&ss,"192.168.1.2",8080);
+*           if (WIFI.sessionRequest(&ss,HPPOST,"/log",rec,5000)==200) 
+*             WIFI.getResponseBody(ss.sk,NULL,buff,16);
+*/
+  void sessionBegin(HTTPSESSION *s,char *ip,uint16_t port);
+  int sessionRequest(HTTPSESSION *s,uint8_t method,char *resource,char *data,int timeout);
+
+/*
+*  Pipelined batch: n requests (data[i] for each one; data NULL for GET and 
+*  DELETE) to resource on the session link, written one after the other 
+*  without waiting for responses (up to PIPEMAX waiting), then responses 
+*  read in order. fun (if not NULL) gets index and status code of each 
+*  response (Response filled: fun can read the body with readResponse, the
+*  rest is dropped). If the server closes the link after a response, 
+*  requests not answered are sent again on a new link. If a kept link 
+*  fails before any answer, requests are sent again on a new one only if 
+*  none was written (GET and DELETE always): POST and PUT written may have
+*  been done by the server.
+*  Returns the number of requests answered (n if all).
+*/
+  int sessionBatch(HTTPSESSION *s,uint8_t method,char *resource,char *data[],int n,void (*fun)(int i,int code),int timeout);
+  void sessionEnd(HTTPSESSION *s);
+
 
 
 /*
@@ -289,6 +557,50 @@ public:
 */
    unsigned int getNextResponseBuffer(int sk,unsigned char rbuff[],int rbufflen);
 
+/*
+*   Response body is read exactly: Content-Length bytes, or chunks of a 
+*   chunked response (Transfer-Encoding) decoded, so buffers get only body
+*   bytes. Each reading waits up to RESPTOUT millisec for bytes still to come.
+*   responseEnd() is true when the whole body has been read (then 
+*   getNextResponseBuffer returns 0); bytes after it (next response on the
+*   same link) are not lost.
+*/
+   bool responseEnd();
+
+/*
+*   Response read a part at a time (as for long downloads). 
+*   getResponseHead reads status line and headers in Response (code, 
+*   Content-Length, Content-Type, chunked, link kept) waiting timeout millisec;
+*   returns status code, 0 if response not arrived or -1 if not valid. Then
+*   body (of any status code) is read exactly: Response.left is the number 
+*   of bytes still to come (-1 if not known: chunked or until link closed).
+*   readResponse: next body segment in buff (iterator), 0 at body end (see 
+*   responseEnd) or if nothing arrives in RESPTOUT millisec.
+*   getResponseBody: all body given to fun a segment at a time (buff of 
+*   lbuff bytes as work area; fun NULL to drop it). Returns body length, or 
+*   -1 if body not complete (timeout or bad chunked body). A body without 
+*   Content-Length and not chunked (it ends when server closes the link) 
+*   is complete when nothing more arrives in RESPTOUT millisec.
+*   Example: if (WIFI.getResponseHead(sk,5000)==200) 
+*              WIFI.getResponseBody(sk,saveBlock,buff,64);
+*/
+   int getResponseHead(int sk,int timeout);
+   int readResponse(int sk,uint8_t *buff,int lbuff);
+   long getResponseBody(int sk,void (*fun)(uint8_t *data,int len),uint8_t *buff,int lbuff);
+
+/*
+*   JSON response: body is given to jp (see utility/JSONPARSER.h) piece by 
+*   piece as it arrives, so selected values (jp->select) are extracted 
+*   without storing the body. timeout: millisec max for response and for 
+*   each following piece.
+*   Returns JPDONE, JPERROR (not JSON), JPMORE (body not complete in time),
+*   -1 if response not arrived or -2 if response error (not 200).
+*   Example: JSONPARSER jp; jp.begin(); jp.select(pTemp,temp,8);
+*            WIFI.sendRequestGET(sk,"/weather");
+*            if (WIFI.getResponseJSON(sk,&jp,5000)==JPDONE) ...
+*/
+   int getResponseJSON(int sk,JSONPARSER *jp,int timeout);
+
 /*
 *   Get response message code. It can be called after  getResponse functions.
 */
@@ -328,20 +640,98 @@ public:
 	  char name[URILEN];
 	  char query[QUERYLEN];
 	  int qlen; 
+	  int sk;                            //socket of request
+	  uint8_t method;                    //HPGET, HPPOST... (see HTTPPARSER.h)
+	  uint8_t nargs;                     //segments captured by route
+	  char args[ROUTEARGLEN];            //captured segments (see routeArg)
+	  bool keep;                         //link kept after response
+	  char inm[ETAGLEN];                 //If-None-Match of request
   }Resource;
+
+// last response received (client), see getResponseHead
+	struct cresp
+	{
+	  int code;                          //status code (0: none, -1: not valid)
+	  long clen;                         //Content-Length (-1: not present)
+	  long left;                         //body bytes still to read (-1: not known)
+	  long received;                     //body bytes read
+	  bool chunked;                      //Transfer-Encoding: chunked
+	  bool keep;                         //link kept by server
+	  char ctype[CTYPELEN];              //Content-Type
+  }Response;
+
+// state of multi client server (see startServer)
+	struct srv
+	{
+	  uint8_t ssk;                       //listening socket (0xFF: none)
+	  uint8_t csk[SERVCLIENTS];          //client sockets (0xFF: free)
+	  unsigned long tlast[SERVCLIENTS];  //millis of accept or last request
+	  uint8_t nreq[SERVCLIENTS];         //requests served on link
+	  uint8_t next;                      //next client to read (round robin)
+	  unsigned long tacc;                //millis of last accept poll
+	  unsigned int iacc;                 //interval of accept polls
+  }Server;
   
 
 private:
   
   BASE64 B64;
+  HTTPPARSER Parser;
+  const WEBROUTE *Routes;           //route table (NULL: WEBRES arrays)
+  int nroutes;
+  const uint8_t *rslots;            //perfect hash slots of route table
+  uint8_t nslots;
+  int rpat;                         //first pattern route
+  uint8_t wsk;                      //response writer (see wrBegin)
+  long wleft;
+  uint16_t wfree;
+  bool wopen;
+  long wsent;                       //bytes really sent (dataSent of frames)
+  uint8_t rstate;                   //response body reading (see bodyRead)
+  long rleft;
+  uint8_t rline;
 /* functions called by previous principal get/send functions  */
-	void reqGET(int socket,char *endl,int nres,WEBRES rs[],char *key);
-	void reqPOST(int socket,char *endl,int nres,WEBRES rs[],char *key);
+	int handleRequest(int socket,int nres,WEBRES rs[],char *key,bool keepok);
+	void readBody(int socket,long len,bool store);
+	void respCode(int sk,int code);
+	int headLen();
+	void putHead();
+	void putLongHead(int sk);
+	void serverAccept();
 	void activateRes(int sk,int nres,WEBRES rs[]);
+	void activateRoute(int sk);
+	int routeSearch(long key);
+	bool routeMatch(char *uri,prog_char *pat);
+	void routeCall(int i);
 	void startLongResponse(int sk);
-	void sendChunkResponse(int sk,prog_char data[],int ldata,char* param);
 	void endLongResponse(int sk);
-	char* checkHeader(char *buff, prog_char *header);
+	int chunkLen(int ldata,char *spar);
+	void putChunk(prog_char data[],int ldata,char* spar);
+	void sendPage(int sk,prog_char *page,int npar,char *param[],uint8_t ends);
+	int pageFrame(int sk,prog_char *page,int *pos,int *np,int npar,char *param[],uint8_t *ends);
+	void wrBegin(int sk,int hlen,long blen);
+	void wrLenHead(int sk,long len);
+	bool etagMatch(uint32_t etag,bool gz);
+	void respAdd(RESPBUILD *r,const char *str,bool pm);
+	prog_char* statusText(int code);
+	void jsonOpen(JSONWRITER *j,char c,bool arr);
+	bool jsonSep(JSONWRITER *j);
+	void jsonPut(JSONWRITER *j,const char *str,int len,bool pm);
+	void jsonQuoted(JSONWRITER *j,const char *str,bool pm);
+	void jsonFlush(JSONWRITER *j,bool last);
+	int respHead(uint8_t type,uint8_t hf,uint32_t etag,uint32_t maxage,long len,bool put);
+	int hpart(const void *p,int len,bool pm,bool put);
+	void wrPut(const void *data,long len,bool pm);
+	void wrEnd();
+	int dynChunk(prog_char *page,int len,int pos,int *np,int npar,char *param[],char **spar);
+	bool sendRequest(int sk,prog_char *method,char *host,char* headers[],int nh,char* resource,char* data);
+	int reqHead(prog_char *method,char *host,char* headers[],int nh,char* resource,long dlen,bool put);
+	uint8_t sessionLink(HTTPSESSION *s);
+	bool sessionSend(HTTPSESSION *s,uint8_t method,char *resource,char *data);
+	int bodyRead(int sk,uint8_t *buff,int lbuff);
+	void chunkByte(uint8_t c);
+	int bodyWait(int sk,uint8_t *buff,int lbuff,int timeout);
+	void bodySkip(int sk);
 	bool checkUserPsw(char *param,char *userpsw);
 
 /* functions used by previous principal parameter functions */
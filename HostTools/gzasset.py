@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+"""
+Static asset generator for HTTP library (WEBASSET, see sendAsset).
+
+Input: files (HTML, CSS, JS, JSON, images ...). Each file is compressed with
+gzip (best level, fixed header so output doesn't change between runs) and
+written as a PROGMEM byte array with its WEBASSET struct. Content type comes
+from the file extension. If gzip doesn't make the file smaller (images) it
+is stored as it is.
+
+--plain also stores the not compressed file, sent to clients that don't
+accept gzip (else they get 406). It costs more flash.
+ETag is the CRC32 of the file: a browser asking again for the same content
+gets only a 304 header. --max-age N lets browsers keep files N seconds
+without asking (use it for files that don't change, like libraries).
+
+Usage: python3 gzasset.py index.html style.css app.js [-o assets.h] [--plain]
+                          [--max-age N]
+Asset name: file name with '.' and '-' as '_' (index.html -> index_html),
+or --name for a single file.
+"""
+
+import argparse
+import gzip
+import os
+import re
+import sys
+import zlib
+
+TYPES = {".html": "ASSETHTML", ".htm": "ASSETHTML", ".css": "ASSETCSS",
+         ".js": "ASSETJS", ".json": "ASSETJSON", ".txt": "ASSETTEXT",
+         ".png": "ASSETPNG", ".jpg": "ASSETJPEG", ".jpeg": "ASSETJPEG",
+         ".gif": "ASSETGIF", ".ico": "ASSETICO", ".svg": "ASSETSVG"}
+
+
+def compress(data):
+    return gzip.compress(data, compresslevel=9, mtime=0)
+
+
+def c_bytes(data):
+    lines = []
+    for i in range(0, len(data), 16):
+        lines.append("  " + ",".join("0x%02X" % b for b in data[i:i + 16]))
+    return ",\n".join(lines)
+
+
+def c_name(path):
+    return re.sub(r"[^A-Za-z0-9_]", "_", os.path.basename(path))
+
+
+def asset(path, name, plain, maxage, out):
+    with open(path, "rb") as f:
+        data = f.read()
+    return write_asset(path, data, name, plain, maxage, out)
+
+
+def write_asset(path, data, name, plain, maxage, out, zip=True):
+    """WEBASSET of data (content type from path); returns (length, sent)."""
+    if len(data) > 0xFFFF:
+        raise ValueError("%s: longer than 65535 bytes" % path)
+    ctype = TYPES.get(os.path.splitext(path)[1].lower(), "ASSETBIN")
+    gz = compress(data)
+    zipped = zip and len(gz) < len(data)
+    body = gz if zipped else data
+    out.write("// %s: %d bytes%s\n" % (os.path.basename(path), len(data),
+              ", gzip %d (%.1fx)" % (len(gz), len(data) / float(len(gz)))
+              if zipped else ""))
+    out.write("const uint8_t %s_data[] PROGMEM={\n%s\n};\n" % (name, c_bytes(body)))
+    ref = "NULL,0"
+    if zipped and plain:
+        out.write("const uint8_t %s_plain[] PROGMEM={\n%s\n};\n" % (name, c_bytes(data)))
+        ref = "(prog_char*)%s_plain,%d" % (name, len(data))
+    etag = zlib.crc32(data) & 0xFFFFFFFF or 1
+    out.write("const WEBASSET %s PROGMEM={(prog_char*)%s_data,%d,%s,%s,%s,"
+              "0x%08XUL,%dUL};\n\n"
+              % (name, name, len(body), ref, ctype, "ASSETGZIP" if zipped else "0",
+                 etag, maxage))
+    return len(data), len(body)
+
+
+def main():
+    ap = argparse.ArgumentParser(description="WEBASSET generator")
+    ap.add_argument("files", nargs="+")
+    ap.add_argument("-o", "--out", help="output file (default: standard output)")
+    ap.add_argument("--name", help="asset name (one file only)")
+    ap.add_argument("--plain", action="store_true",
+                    help="store also not compressed content")
+    ap.add_argument("--max-age", type=int, default=0,
+                    help="seconds browsers can keep files without asking")
+    a = ap.parse_args()
+    if a.name and len(a.files) > 1:
+        sys.exit("gzasset: --name only with one file")
+    out = open(a.out, "w") if a.out else sys.stdout
+    out.write("// Assets made by gzasset.py: don't edit, run it again.\n\n")
+    total = [0, 0]
+    try:
+        for path in a.files:
+            n, z = asset(path, a.name or c_name(path), a.plain, a.max_age, out)
+            total[0] += n
+            total[1] += z
+    except (OSError, ValueError) as e:
+        sys.exit("gzasset: %s" % e)
+    finally:
+        if a.out:
+            out.close()
+    sys.stderr.write("%d bytes -> %d bytes sent\n" % tuple(total))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,216 @@
+#!/usr/bin/env python3
+"""
+Capture tool for the traffic between Arduino and MCW1001A (WIFICAPTURE 1).
+
+Commands:
+  record  --serial PORT [--baud N] | --tcp PORT   OUTFILE
+      saves the log sent by startCapture() on Serial, or by
+      startCapture(sk)/flushCapture() on a socket connected to this computer
+      (Ctrl-C to stop).
+  dump    FILE
+      shows the log as a timeline of frames (direction, code, length).
+  replay  FILE --serial PORT [--baud 57600] [--fast]
+      plays the MCW side of the log toward an Arduino whose WIFI serial pins
+      (RXPIN, TXPIN) are connected to a USB-serial adapter instead of the
+      shield. Bytes sent by Arduino are compared with the log; bytes from MCW
+      are sent with the original timing, or as soon as possible with --fast.
+      At the end original and replay durations are reported.
+
+Serial ports need the pyserial package (pip install pyserial).
+"""
+
+import argparse
+import socket
+import struct
+import sys
+import time
+
+from mcwcodes import command_name, response_name
+
+MAGIC = b"MWCAP"
+WRAP = 1 << 32
+
+
+def read_records(data):
+    """Yields (direction, micros, bytes) ; direction '>' to MCW, '<' from MCW.
+    Lost bytes are yielded as ('!', None, count)."""
+    pos = data.find(MAGIC)
+    if pos < 0:
+        raise ValueError("no capture header found")
+    pos += len(MAGIC) + 1
+    while pos < len(data):
+        tag = data[pos]
+        pos += 1
+        if tag == 0:
+            if pos + 2 > len(data):
+                break
+            yield "!", None, struct.unpack_from("<H", data, pos)[0]
+            pos += 2
+            continue
+        n = tag & 0x7F
+        if pos + 4 + n > len(data):
+            break
+        t = struct.unpack_from("<I", data, pos)[0]
+        pos += 4
+        yield ("<" if tag & 0x80 else ">"), t, data[pos:pos + n]
+        pos += n
+
+
+def merge(records):
+    """Joins consecutive records with same direction (a frame can be split)."""
+    cur = None
+    for d, t, b in records:
+        if d == "!":
+            if cur:
+                yield cur
+                cur = None
+            yield d, t, b
+            continue
+        if cur and cur[0] == d:
+            cur = (d, cur[1], cur[2] + b)
+        else:
+            if cur:
+                yield cur
+            cur = (d, t, b)
+    if cur:
+        yield cur
+
+
+def frames(payload):
+    """Splits a byte run in MCW frames: (code, length) for each 0x55 0xAA."""
+    out = []
+    i = 0
+    while i + 6 <= len(payload):
+        if payload[i] == 0x55 and payload[i + 1] == 0xAA:
+            code = 0 if payload[i + 3] == 0x80 else payload[i + 2]
+            ln = payload[i + 4] | (payload[i + 5] << 8)
+            out.append((code, ln))
+            i += 7 + ln
+        else:
+            i += 1
+    return out
+
+
+def cmd_dump(args):
+    data = open(args.file, "rb").read()
+    prev = None
+    elapsed = 0
+    for d, t, b in merge(read_records(data)):
+        if d == "!":
+            print("%10s %9s ! %d bytes lost" % ("", "", b))
+            continue
+        if prev is None:
+            prev = t
+        delta = (t - prev) % WRAP
+        elapsed += delta
+        prev = t
+        names = []
+        for code, ln in frames(b):
+            name = command_name(code) if d == ">" else response_name(code)
+            names.append("%s(%d)" % (name, ln))
+        print("%10.3f %+9.3f %s %5d  %s" % (elapsed / 1000.0, delta / 1000.0,
+                                           d, len(b), " ".join(names)))
+
+
+def cmd_record(args):
+    out = open(args.outfile, "wb")
+    total = 0
+    try:
+        if args.serial:
+            import serial
+            port = serial.Serial(args.serial, args.baud, timeout=0.2)
+            while True:
+                b = port.read(256)
+                if b:
+                    out.write(b)
+                    out.flush()
+                    total += len(b)
+        else:
+            srv = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+            srv.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+            srv.bind(("", args.tcp))
+            srv.listen(1)
+            print("waiting for Arduino on port %d" % args.tcp)
+            conn, addr = srv.accept()
+            print("connected with %s" % addr[0])
+            while True:
+                b = conn.recv(1024)
+                if not b:
+                    break
+                out.write(b)
+                out.flush()
+                total += len(b)
+    except KeyboardInterrupt:
+        pass
+    out.close()
+    print("%d bytes saved" % total)
+
+
+def cmd_replay(args):
+    import serial
+    recs = [r for r in merge(read_records(open(args.file, "rb").read()))
+            if r[0] != "!"]
+    port = serial.Serial(args.serial, args.baud, timeout=args.timeout)
+    port.reset_input_buffer()
+    bytetime = 10.0 / args.baud
+    mismatch = 0
+    t0 = prev_end = None
+    ref = start = time.time()
+    for d, t, b in recs:
+        if t0 is None:
+            t0 = prev_end = t
+        # original silence between end of previous run and this one
+        gap = ((t - prev_end) % WRAP) / 1e6
+        prev_end = (t + int(len(b) * bytetime * 1e6)) % WRAP
+        if d == ">":
+            got = port.read(len(b))
+            if len(got) < len(b):
+                print("timeout: %d of %d bytes from Arduino" % (len(got), len(b)))
+                break
+            if got != b:
+                mismatch += 1
+                print("mismatch: %s\n     log: %s" % (got.hex(), b.hex()))
+        else:
+            if not args.fast:
+                wait = gap - (time.time() - ref)
+                if wait > 0:
+                    time.sleep(wait)
+            port.write(b)
+            port.flush()
+        ref = time.time()
+    orig = ((prev_end - t0) % WRAP) / 1e6 if t0 is not None else 0
+    print("runs: %d  mismatches: %d" % (len(recs), mismatch))
+    print("original: %.3f s  replay: %.3f s" % (orig, time.time() - start))
+
+
+def main():
+    ap = argparse.ArgumentParser(description="MWiFi traffic capture tool")
+    sub = ap.add_subparsers(dest="cmd")
+    r = sub.add_parser("record")
+    r.add_argument("--serial")
+    r.add_argument("--baud", type=int, default=115200)
+    r.add_argument("--tcp", type=int)
+    r.add_argument("outfile")
+    d = sub.add_parser("dump")
+    d.add_argument("file")
+    p = sub.add_parser("replay")
+    p.add_argument("file")
+    p.add_argument("--serial", required=True)
+    p.add_argument("--baud", type=int, default=57600)
+    p.add_argument("--fast", action="store_true")
+    p.add_argument("--timeout", type=float, default=5.0)
+    args = ap.parse_args()
+    if args.cmd == "record":
+        if not args.serial and not args.tcp:
+            ap.error("record needs --serial or --tcp")
+        cmd_record(args)
+    elif args.cmd == "dump":
+        cmd_dump(args)
+    elif args.cmd == "replay":
+        cmd_replay(args)
+    else:
+        ap.print_help()
+
+
+if __name__ == "__main__":
+    main()
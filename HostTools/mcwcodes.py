@@ -0,0 +1,30 @@
+"""
+Names of MCW1001A command and response codes, as used by MWiFi library.
+Shared by the host tools of this directory.
+"""
+
+COMMANDS = {
+    41: "SET_IP", 42: "SET_NETMASK", 44: "SET_GATEWAY", 48: "GET_NET_INFO",
+    55: "SET_NET_MODE", 57: "SET_SSID", 65: "SET_OPEN", 68: "SET_WPA",
+    71: "GET_WPA_KEY", 80: "SCAN_START", 81: "SCAN_GET", 90: "CONNECT",
+    91: "DISCONNECT", 102: "SET_POWER", 110: "SOCK_CREATE", 111: "SOCK_CLOSE",
+    112: "SOCK_BIND", 113: "SOCK_CONNECT", 114: "SOCK_LISTEN",
+    115: "SOCK_ACCEPT", 116: "SOCK_SEND", 117: "SOCK_RECV", 121: "PING",
+    122: "SOCK_ALLOC", 170: "RESET", 172: "GPIO", 173: "SET_ARP",
+}
+
+RESPONSES = {
+    0: "ACK", 1: "EVENT", 22: "SCAN_RESULT", 23: "SOCK_CREATE_R",
+    24: "SOCK_BIND_R", 25: "SOCK_CONNECT_R", 26: "SOCK_LISTEN_R",
+    27: "SOCK_ACCEPT_R", 28: "SOCK_SEND_R", 29: "SOCK_RECV_R",
+    48: "NET_INFO", 49: "WPA_KEY",
+    0xFD: "NO_ANSWER", 0xFE: "TIMEOUT", 0xFF: "BAD_FRAME",
+}
+
+
+def command_name(code):
+    return COMMANDS.get(code, "CMD_%d" % code)
+
+
+def response_name(code):
+    return RESPONSES.get(code, "RESP_%d" % code)
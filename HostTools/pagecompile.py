@@ -0,0 +1,145 @@
+#!/usr/bin/env python3
+"""
+Page compiler for HTTP library (DYNPAGE, see sendDynResponse).
+
+Input: one or more HTML files (modules, joined in order) with tags '@' where
+the strings of param[] go, in order ('@@' is a '@' character of the page).
+Output: C code for the sketch: page text without tags in PROGMEM, the end
+offset of each text segment and the DYNPAGE struct. The library sends the
+segments and the strings without scanning the page, with exact
+Content-Length. Pages without tags get an ETag (CRC32 of text): browsers
+asking again get only a 304 header.
+
+Whitespace runs become one space (a browser shows them so); <pre> and 
+<textarea> are kept as they are and lines of <script> are only trimmed 
+(line ends kept: automatic semicolons). Use --raw to keep the text exactly 
+as it is.
+
+Usage: python3 pagecompile.py index.html [more.html ...] [-o page.h]
+                              [--name pageIndex] [--raw]
+"""
+
+import argparse
+import os
+import re
+import sys
+import zlib
+
+LINE = 72          # max length of string lines in output
+
+KEEP = re.compile(r"<(pre|textarea|script)\b.*?</\1\s*>", re.S | re.I)
+
+
+def squeeze(text):
+    """Whitespace runs as one space, except in <pre>, <textarea> (kept) and
+    <script> (lines trimmed, empty lines dropped)."""
+    out, pos = [], 0
+    for m in KEEP.finditer(text):
+        out.append(re.sub(r"\s+", " ", text[pos:m.start()]))
+        block = m.group(0)
+        if m.group(1).lower() == "script":
+            block = "\n".join(l.strip() for l in block.splitlines() if l.strip())
+        out.append(block)
+        pos = m.end()
+    out.append(re.sub(r"\s+", " ", text[pos:]))
+    return "".join(out).strip()
+
+
+def load(files, raw):
+    text = ""
+    for name in files:
+        with open(name, encoding="latin-1") as f:
+            data = f.read()
+        if not raw:
+            data = squeeze(data)
+        text += data
+    return text
+
+
+def split(text):
+    """Returns (text without tags, end offset of each segment)."""
+    out, segs = [], []
+    i = 0
+    while i < len(text):
+        c = text[i]
+        if c == "@":
+            if text[i + 1:i + 2] == "@":
+                out.append("@")
+                i += 2
+                continue
+            segs.append(len(out))
+        else:
+            out.append(c)
+        i += 1
+    segs.append(len(out))
+    return "".join(out), segs
+
+
+def c_string(s):
+    """C string literal lines (octal escapes for non printable bytes)."""
+    lines, cur = [], ""
+    for c in s:
+        if c in '"\\':
+            e = "\\" + c
+        elif c == "\n":
+            e = "\\n"
+        elif c == "\r":
+            e = "\\r"
+        elif c == "\t":
+            e = "\\t"
+        elif " " <= c <= "~":
+            e = c
+        else:
+            e = "\\%03o" % ord(c)
+        cur += e
+        if len(cur) >= LINE or c == "\n":
+            lines.append(cur)
+            cur = ""
+    if cur or not lines:
+        lines.append(cur)
+    return "\n".join('"%s"' % l for l in lines)
+
+
+def check(text, segs):
+    if len(text) > 0xFFFF:
+        raise ValueError("page longer than 65535 bytes")
+    if len(segs) > 255:
+        raise ValueError("more than 254 tags")
+
+
+def generate(text, segs, name, sources, out):
+    out.write("// Page made by pagecompile.py from %s: don't edit, run it again.\n"
+              % " ".join(os.path.basename(f) for f in sources))
+    out.write("// %d bytes, %d tags\n\n" % (len(text), len(segs) - 1))
+    out.write("prog_char %s_text[] PROGMEM=\n%s;\n\n" % (name, c_string(text)))
+    out.write("const uint16_t %s_segs[] PROGMEM={" % name)
+    out.write(",".join(str(s) for s in segs))
+    out.write("};\n\n")
+    etag = 0
+    if len(segs) == 1:
+        etag = zlib.crc32(text.encode("latin-1")) & 0xFFFFFFFF or 1
+    out.write("const DYNPAGE %s PROGMEM={%s_text,%s_segs,%d,%d,0x%08XUL};\n"
+              % (name, name, name, len(text), len(segs), etag))
+
+
+def main():
+    ap = argparse.ArgumentParser(description="DYNPAGE compiler")
+    ap.add_argument("files", nargs="+")
+    ap.add_argument("-o", "--out", help="output file (default: standard output)")
+    ap.add_argument("--name", default="page", help="DYNPAGE name")
+    ap.add_argument("--raw", action="store_true", help="keep lines as they are")
+    a = ap.parse_args()
+    text, segs = split(load(a.files, a.raw))
+    try:
+        check(text, segs)
+    except ValueError as e:
+        sys.exit("pagecompile: %s" % e)
+    if a.out:
+        with open(a.out, "w") as out:
+            generate(text, segs, a.name, a.files, out)
+    else:
+        generate(text, segs, a.name, a.files, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
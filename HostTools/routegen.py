@@ -0,0 +1,141 @@
+#!/usr/bin/env python3
+"""
+Route table generator for HTTP library (WEBROUTE, see setRoutes).
+
+Input: a text file with one route per line
+    METHODS  URI  FUNCTION
+where METHODS is GET, POST, PUT, DELETE (more joined by '|') or ANY, URI is
+an exact name ("/index") or a pattern ("/led/+" one segment, "/files/*" the
+rest of the path), FUNCTION is the call back function. Lines starting with
+'#' and empty lines are ignored. Example:
+    GET       /index     pindex
+    GET|POST  /config    pconfig
+    ANY       /led/+     pled
+
+Output: C code for the sketch: call back prototypes, route names in PROGMEM,
+the table (exact names sorted by hash, then patterns in input order) and its
+length define, and the slot table of a perfect hash of the exact names
+(slot hash % N<name>_SLOTS: index + 1 of the first route with that hash, 0
+none), so the library finds a name with one lookup:
+    WIFI.setRoutes(NROUTES,routes,routes_slots,NROUTES_SLOTS);
+
+Usage: python3 routegen.py routes.txt [-o routes.h] [--name routes]
+"""
+
+import argparse
+import sys
+
+METHODS = {"GET": "HPGET", "POST": "HPPOST", "PUT": "HPPUT",
+           "DELETE": "HPDELETE", "HEAD": "HPHEAD"}
+
+
+def route_hash(uri):
+    """As HTTP::routeHash: 16 bit djb2 (xor), never 0."""
+    h = 5381
+    for c in uri.encode("latin-1"):
+        h = (((h << 5) + h) ^ c) & 0xFFFF
+    return h or 1
+
+
+def perfect_slots(hashes):
+    """Smallest table size m with hashes % m all different, and the table
+    (index + 1 of first route with that hash, 0 for empty slots)."""
+    keys = sorted(set(hashes))
+    if len(hashes) > 255:
+        raise ValueError("more than 255 exact routes")
+    m = max(len(keys), 1)
+    while len(set(k % m for k in keys)) < len(keys):
+        m += 1
+    slots = [0] * m
+    for i, h in enumerate(hashes):
+        if slots[h % m] == 0:
+            slots[h % m] = i + 1
+    return slots
+
+
+def is_pattern(uri):
+    return "+" in uri or "*" in uri
+
+
+def parse(lines):
+    routes = []
+    for n, line in enumerate(lines, 1):
+        line = line.strip()
+        if not line or line.startswith("#"):
+            continue
+        f = line.split()
+        if len(f) != 3:
+            raise ValueError("line %d: METHODS URI FUNCTION expected" % n)
+        meths, uri, fun = f
+        if meths.upper() == "ANY":
+            mask = "0"
+        else:
+            try:
+                mask = "|".join(METHODS[m] for m in meths.upper().split("|"))
+            except KeyError as e:
+                raise ValueError("line %d: unknown method %s" % (n, e))
+        if not uri.startswith("/"):
+            raise ValueError("line %d: URI must start with /" % n)
+        if "*" in uri[:-1]:
+            raise ValueError("line %d: '*' allowed only at the end" % n)
+        routes.append((uri, mask, fun, n))
+    return routes
+
+
+def generate(routes, name, out):
+    exact = [r for r in routes if not is_pattern(r[0])]
+    pattern = [r for r in routes if is_pattern(r[0])]
+    seen = {}
+    for uri, mask, fun, n in exact:
+        key = (uri, mask)
+        if key in seen:
+            raise ValueError("line %d: route already at line %d" % (n, seen[key]))
+        seen[key] = n
+    exact.sort(key=lambda r: route_hash(r[0]))        # stable: input order kept
+    table = exact + pattern
+    out.write("// Route table made by routegen.py: don't edit, run it again.\n\n")
+    funs = []
+    for r in table:
+        if r[2] not in funs:
+            funs.append(r[2])
+    for fun in funs:
+        out.write("void %s(char *query);\n" % fun)
+    out.write("\n")
+    for i, (uri, mask, fun, n) in enumerate(table):
+        out.write('prog_char %s_%d[] PROGMEM="%s";\n' % (name, i, uri))
+    out.write("\nconst WEBROUTE %s[] PROGMEM={\n" % name)
+    for i, (uri, mask, fun, n) in enumerate(table):
+        h = 0 if is_pattern(uri) else route_hash(uri)
+        sep = "," if i < len(table) - 1 else ""
+        out.write("  {0x%04X,%s,%s_%d,%s}%s\n" % (h, mask, name, i, fun, sep))
+    out.write("};\n")
+    out.write("#define N%s %d\n" % (name.upper(), len(table)))
+    slots = perfect_slots([route_hash(r[0]) for r in exact])
+    out.write("\nconst uint8_t %s_slots[] PROGMEM={%s};\n"
+              % (name, ",".join(str(s) for s in slots)))
+    out.write("#define N%s_SLOTS %d\n" % (name.upper(), len(slots)))
+
+
+def main():
+    ap = argparse.ArgumentParser(description="WEBROUTE table generator")
+    ap.add_argument("file")
+    ap.add_argument("-o", "--out", help="output file (default: standard output)")
+    ap.add_argument("--name", default="routes", help="table name")
+    a = ap.parse_args()
+    with open(a.file) as f:
+        try:
+            routes = parse(f)
+        except ValueError as e:
+            sys.exit("routegen: %s" % e)
+    try:
+        if a.out:
+            with open(a.out, "w") as out:
+                generate(routes, a.name, out)
+        else:
+            generate(routes, a.name, sys.stdout)
+    except ValueError as e:
+        sys.exit("routegen: %s" % e)
+
+
+if __name__ == "__main__":
+    main()
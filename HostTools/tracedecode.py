@@ -0,0 +1,64 @@
+#!/usr/bin/env python3
+"""
+Decoder of the MWiFi frame trace (WIFIDEBUG 1, dumpTrace function).
+
+Input: lines "micros direction code length result" as printed by dumpTrace()
+on Serial or sent by dumpTrace(sk) on a socket (for example saved by
+SocketLog.jar). Other lines are ignored, so a whole console log can be used.
+
+Output: a timeline with time relative to first record, delta from previous
+record and, for each answer, latency from the command sent before it.
+
+Usage: python3 tracedecode.py [file]      (default: standard input)
+"""
+
+import sys
+
+from mcwcodes import command_name, response_name
+
+RESULTS = {0: "", 1: "incomplete", 2: "no trailer", 3: "no answer"}
+WRAP = 1 << 32          # micros() overflow
+
+
+def parse(lines):
+    for line in lines:
+        f = line.split()
+        if len(f) != 5 or f[1] not in (">", "<"):
+            continue
+        try:
+            yield int(f[0]), f[1], int(f[2]), int(f[3]), int(f[4])
+        except ValueError:
+            continue
+
+
+def timeline(records, out):
+    start = prev = sent = None
+    elapsed = 0
+    for t, d, code, length, res in records:
+        if prev is None:
+            start = prev = t
+        delta = (t - prev) % WRAP
+        elapsed += delta
+        prev = t
+        if d == ">":
+            name = command_name(code)
+            sent = elapsed
+            lat = ""
+        else:
+            name = response_name(code)
+            lat = "" if sent is None else "%9.3f" % ((elapsed - sent) / 1000.0)
+        out.write("%10.3f %+9.3f %s %-15s %5d %9s %s\n" % (
+            elapsed / 1000.0, delta / 1000.0, d, name, length, lat,
+            RESULTS.get(res, str(res))))
+    if start is None:
+        out.write("no trace records\n")
+
+
+def main():
+    src = open(sys.argv[1]) if len(sys.argv) > 1 else sys.stdin
+    sys.stdout.write("   time ms  delta ms   frame            len  latency\n")
+    timeline(parse(src), sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
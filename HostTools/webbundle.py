@@ -0,0 +1,175 @@
+#!/usr/bin/env python3
+"""
+Web bundle builder for HTTP library.
+
+Input: a directory of web files (HTML, CSS, JS, images ...), subdirectories
+included. Every file is minified (HTML, CSS, JS) and written in one header:
+  - files without tags: WEBASSET (gzip compressed unless --no-gzip, ETag,
+    content type), sent by a call back function made here;
+  - HTML files with tags '@' (see sendDynResponse, '@@' is a '@'): DYNPAGE,
+    and the sketch writes the call back function (name in output comment)
+    giving the strings for the tags;
+  - route table (WEBROUTE, see setRoutes) with all files: "/dir/name.ext",
+    index.html as "/index" (library maps "/" to "/index"); more routes of
+    sketch functions (AJAX, forms) from --routes file (see routegen.py).
+
+Sketch:
+  HTTP WIFI;
+  #include "web.h"
+  ...  WIFI.setRoutes(NROUTES,routes,routes_slots,NROUTES_SLOTS);
+
+Usage: python3 webbundle.py webdir [-o web.h] [--routes routes.txt]
+                           [--server WIFI] [--no-gzip] [--plain] [--max-age N]
+"""
+
+import argparse
+import os
+import re
+import sys
+
+import gzasset
+import pagecompile
+import routegen
+
+URILEN = 48            # resource name buffer of library (HTTPlib.h)
+
+
+def minify_html(text):
+    """Comments removed, whitespace runs as one space; <pre> and <textarea>
+    kept, inline scripts as minify_js."""
+    text = re.sub(r"<!--.*?-->", "", text, flags=re.S)
+    out, pos = [], 0
+    for m in pagecompile.KEEP.finditer(text):
+        out.append(re.sub(r"\s+", " ", text[pos:m.start()]))
+        block = m.group(0)
+        if m.group(1).lower() == "script":
+            s = re.match(r"(<script[^>]*>)(.*)(</script\s*>)$", block, re.S | re.I)
+            block = s.group(1) + minify_js(s.group(2)) + s.group(3)
+        out.append(block)
+        pos = m.end()
+    out.append(re.sub(r"\s+", " ", text[pos:]))
+    return "".join(out).strip()
+
+
+def minify_css(text):
+    text = re.sub(r"/\*.*?\*/", "", text, flags=re.S)
+    text = re.sub(r"\s+", " ", text)
+    text = re.sub(r"\s*([{};,>])\s*", r"\1", text)
+    return text.replace(";}", "}").strip()
+
+
+def minify_js(text):
+    """Conservative: blank lines, indentation and whole-line // comments
+    removed; line ends kept (automatic semicolons)."""
+    text = re.sub(r"/\*.*?\*/", "", text, flags=re.S)
+    lines = (line.strip() for line in text.splitlines())
+    return "\n".join(l for l in lines if l and not l.startswith("//"))
+
+
+MINIFY = {".html": minify_html, ".htm": minify_html, ".css": minify_css,
+          ".js": minify_js}
+
+
+def c_name(rel):
+    return re.sub(r"[^A-Za-z0-9_]", "_", rel)
+
+
+def uri_of(rel):
+    uri = "/" + rel.replace(os.sep, "/")
+    if uri in ("/index.html", "/index.htm"):
+        uri = "/index"
+    return uri
+
+
+def files_of(root):
+    for d, dirs, files in os.walk(root):
+        dirs.sort()
+        for f in sorted(files):
+            if not f.startswith("."):
+                path = os.path.join(d, f)
+                yield path, os.path.relpath(path, root)
+
+
+def bundle(root, out, extra, server, zip, plain, maxage):
+    routes, dynamic = [], []
+    total = [0, 0]
+    out.write("// Web bundle made by webbundle.py from %s: don't edit, run it again.\n\n"
+              % os.path.basename(os.path.normpath(root)))
+    out.write("extern HTTP %s;\n\n" % server)
+    for path, rel in files_of(root):
+        name = c_name(rel)
+        uri = uri_of(rel)
+        if len(uri) >= URILEN:
+            sys.stderr.write("webbundle: %s longer than URILEN-1 (%d)\n"
+                             % (uri, URILEN - 1))
+        ext = os.path.splitext(path)[1].lower()
+        with open(path, "rb") as f:
+            data = f.read()
+        if ext in MINIFY:
+            text = MINIFY[ext](data.decode("latin-1"))
+            if ext in (".html", ".htm") and "@" in text.replace("@@", ""):
+                body, segs = pagecompile.split(text)
+                pagecompile.check(body, segs)
+                pagecompile.generate(body, segs, name, [path], out)
+                out.write("\n")
+                fun = "page_" + name
+                dynamic.append((uri, fun, len(segs) - 1))
+                routes.append((uri, "HPGET", fun, 0))
+                total[0] += len(data)
+                total[1] += len(body)
+                continue
+            if ext in (".html", ".htm"):
+                text = text.replace("@@", "@")
+            data = text.encode("latin-1")
+        n, z = gzasset.write_asset(path, data, name, plain, maxage, out, zip)
+        total[0] += n
+        total[1] += z
+        fun = "web_" + name
+        out.write("void %s(char *query) {%s.sendAsset(%s.Resource.sk,&%s);}\n\n"
+                  % (fun, server, server, name))
+        routes.append((uri, "HPGET", fun, 0))
+    for uri, fun, ntags in dynamic:
+        out.write("// %s: write void %s(char *query) in sketch (%d tags:\n"
+                  "// sendDynResponse(%s.Resource.sk,&%s,%d,param))\n"
+                  % (uri, fun, ntags, server, fun[5:], ntags))
+    if dynamic:
+        out.write("\n")
+    routegen.generate(routes + extra, "routes", out)
+    return total
+
+
+def main():
+    ap = argparse.ArgumentParser(description="web bundle builder")
+    ap.add_argument("dir")
+    ap.add_argument("-o", "--out", help="output file (default: standard output)")
+    ap.add_argument("--routes", help="more routes (routegen.py format)")
+    ap.add_argument("--server", default="WIFI", help="HTTP instance of sketch")
+    ap.add_argument("--no-gzip", action="store_true", help="don't compress")
+    ap.add_argument("--plain", action="store_true",
+                    help="store also not compressed content")
+    ap.add_argument("--max-age", type=int, default=0,
+                    help="seconds browsers can keep static files")
+    a = ap.parse_args()
+    if not os.path.isdir(a.dir):
+        sys.exit("webbundle: %s is not a directory" % a.dir)
+    extra = []
+    if a.routes:
+        try:
+            with open(a.routes) as f:
+                extra = routegen.parse(f)
+        except (OSError, ValueError) as e:
+            sys.exit("webbundle: %s" % e)
+    out = open(a.out, "w") if a.out else sys.stdout
+    try:
+        total = bundle(a.dir, out, extra, a.server, not a.no_gzip, a.plain,
+                       a.max_age)
+    except (OSError, ValueError) as e:
+        sys.exit("webbundle: %s" % e)
+    finally:
+        if a.out:
+            out.close()
+    sys.stderr.write("%d bytes -> %d bytes in flash\n" % tuple(total))
+
+
+if __name__ == "__main__":
+    main()
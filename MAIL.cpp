@@ -148,6 +148,116 @@ bool MAIL::sendMail(char *SmtpServer,char *user,char *psw,char *dest,char *subje
 void MAIL::setTimeout(int millisec){timeout=millisec;}
 
 
+/*
+* Task version: steps of mailStep, each one followed by server reply waited by
+* replyTask. psw NULL for not authenticated protocol (HELO).
+*/
+uint8_t MAIL::sendMailTask(MAILTASK *m,char *SmtpServer,char *user,char *dest,char *subject,char *mess)
+{return sendMailTask(m,SmtpServer,user,NULL,dest,subject,mess);}
+
+uint8_t MAIL::sendMailTask(MAILTASK *m,char *SmtpServer,char *user,char *psw,char *dest,char *subject,char *mess)
+{
+  PT_BEGIN(&m->pt);
+  m->res=false;
+  PT_SPAWN(&m->pt,&m->sub.pt,openSockTCPTask(&m->sub,SmtpServer,25));
+  m->sk=m->sub.res;
+  if (m->sk==0xFF) PT_EXIT(&m->pt);
+  for (m->step=0;m->step<MAILSTEPS;m->step++)
+  {
+    PT_WAIT_UNTIL(&m->pt,lockLink(m));
+    m->expect=mailStep(m->sk,m->step,user,psw,dest,subject,mess);
+    unlockLink(m);
+    if (m->expect==0) continue;                  //step not used
+    PT_SPAWN(&m->pt,&m->sub.pt,replyTask(m));
+    if (m->code!=m->expect) break;
+  }
+  PT_WAIT_UNTIL(&m->pt,lockLink(m));
+  if (m->step>0) sendToServP(m->sk,quit);
+  closeSock(m->sk);
+  unlockLink(m);
+  m->res=(m->step==MAILSTEPS);
+  PT_END(&m->pt);
+}
+
+/*
+* Sends commands of protocol step and returns reply code expected
+* (0 if step is not used)
+*/
+int MAIL::mailStep(int sk,uint8_t step,char *user,char *psw,char *dest,char *subject,char *mess)
+{
+  switch (step)
+  {
+    case 0: return 220;                          //greeting
+    case 1: if (psw==NULL) sendToServP(sk,helo); else sendToServP(sk,ehlo);
+            return 250;
+    case 2: if (psw==NULL) return 0;
+            sendToServP(sk,auth);return 334;
+    case 3: if (psw==NULL) return 0;
+            user64=B64.base64_encode(user);
+            sendToServ(sk,user64);sendToServ(sk,"\r\n");
+            free(user64);return 334;
+    case 4: if (psw==NULL) return 0;
+            psw64=B64.base64_encode(psw); 
+            sendToServ(sk,psw64);sendToServ(sk,"\r\n"); 
+            free(psw64);return 235;
+    case 5: sendToServP(sk,from,user);return 250;
+    case 6: sendToServP(sk,to,dest);return 250;
+    case 7: sendToServP(sk,data);return 354;
+    case 8: sendToServP(sk,head1);
+            sendToServP(sk,head2,subject);
+            sendToServ(sk,"\r\n");
+            sendToServ(sk,mess);
+            sendToServP(sk,endTXT);return 250;
+  }
+  return 0;
+}
+
+/*
+* Sub task: reads server reply a piece at a time (no line buffer) until its
+* last line (code followed by blank) or timeout. Code in m->code (0 if none).
+*/
+uint8_t MAIL::replyTask(MAILTASK *m)
+{
+  uint8_t buff[16];
+  uint16_t i,n;
+  char c;
+  PT_BEGIN(&m->sub.pt);
+  m->code=0;m->rcode=0;m->col=0;m->sep=' ';
+  m->t=millis();
+  while(1)
+  {
+    PT_WAIT_UNTIL(&m->sub.pt,lockLink(m));
+    recvStart(m->sk,sizeof(buff));
+    m->sub.t=millis();
+    PT_WAIT_UNTIL(&m->sub.pt,(m->sub.code=pollAnswer(m->sub.t,10000))!=MCWPENDING);
+    n=recvEnd(buff);
+    unlockLink(m);
+    for (i=0;i<n;i++)
+    {
+      c=buff[i];
+      if (c=='\n')
+      {
+        if (m->sep!='-') 
+        {
+          m->code=m->rcode;
+          if (maildebug) {Serial.print("< ");Serial.println(m->code);}
+          PT_EXIT(&m->sub.pt);
+        }
+        m->col=0;m->rcode=0;m->sep=' ';continue;
+      }
+      if (m->col<3) {if (isdigit(c)) m->rcode=m->rcode*10+c-'0';}
+      else if (m->col==3) m->sep=c;
+      if (m->col<4) m->col++;
+    }
+    if (n>0) {m->t=millis();continue;}
+    if (millis()-m->t>(unsigned long)timeout) PT_EXIT(&m->sub.pt);
+    m->sub.t=millis();
+    PT_WAIT_UNTIL(&m->sub.pt,millis()-m->sub.t>=10);
+  }
+  PT_END(&m->sub.pt);
+}
+
+
 void MAIL::sendToServ(int sk,char *buff)
 {
   writeData(sk,buff);
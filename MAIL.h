@@ -46,6 +46,23 @@
 #include <utility/BASE64.h>
 
 #define maildebug 0              //1 for debug
+#define MAILSTEPS 9              //protocol steps of sendMailTask
+
+// State of sendMailTask. PT_INIT(&task.pt) before first call
+typedef struct
+{
+  PT pt;                         //task continuation
+  WIFITASK sub;                  //sub task state (socket opening, replies)
+  bool res;                      //true if mail sent (when ended)
+  uint8_t sk;                    //socket
+  uint8_t step;                  //protocol step
+  uint8_t col;                   //column in reply line
+  char sep;                      //char after reply code ('-': more lines)
+  int expect;                    //reply code expected
+  int code;                      //reply code received (0: none)
+  int rcode;                     //reply code being read
+  unsigned long t;               //time of last data from server
+} MAILTASK;
 
 
 
@@ -57,6 +74,14 @@ public:
   bool sendMail(char *SmtpServer,char *user,char *psw,char *dest,char *subject,char *mess);
   void setTimeout(int millisec);
 
+/*
+* Task versions of sendMail (see Task functions in MWiFi.h): other tasks can
+* run while waiting for server. Result in task state (res).
+* Arguments must be unchanged until end.
+*/
+  uint8_t sendMailTask(MAILTASK *m,char *SmtpServer,char *user,char *dest,char *subject,char *mess);
+  uint8_t sendMailTask(MAILTASK *m,char *SmtpServer,char *user,char *psw,char *dest,char *subject,char *mess);
+
 private:
   BASE64 B64;
   int timeout;
@@ -72,6 +97,8 @@ private:
   void serialPM(prog_char *buff, int len);  
   void MailExit(int sk);
   int locVar(prog_char *buff);  
+  int mailStep(int sk,uint8_t step,char *user,char *psw,char *dest,char *subject,char *mess);
+  uint8_t replyTask(MAILTASK *m);
 };
 
 #endif
\ No newline at end of file
@@ -45,9 +45,159 @@ static uint8_t GPIOMESS[9]={0x55,0xAA,0xAC,0x00,0x02,0x00,0x00,0x00,0x45};
 
 static int next=0;
 static int frb=0;
+static int lbsk=-1;             //socket of data in linebuff
+static uint16_t framelen=0;     //length of cmd 116 frame being written
+static bool framedrop=false;    //frame begun in yieldHandle: not written
+
+#if WIFIDEBUG
+typedef struct
+{
+  unsigned long time;   //micros at record
+  uint8_t dir;          //'>' to MCW ; '<' from MCW
+  uint8_t code;         //command or response code
+  uint16_t len;         //data length
+  uint8_t res;          //result (TRACEOK,TRACETOUT,TRACEBAD,TRACENOANS)
+} TRACEREC;
+
+static TRACEREC trace[TRACELEN];
+static uint8_t tracepos=0;     //next record to write
+static uint8_t tracenum=0;     //records in ring
+static uint8_t traceon=1;      //0 during dump
+
+static void traceFrame(uint8_t dir,uint8_t code,uint16_t len,uint8_t res)
+{
+        if (!traceon) return;
+        TRACEREC *r=&trace[tracepos];
+        r->time=micros();r->dir=dir;r->code=code;r->len=len;r->res=res;
+        if (++tracepos>=TRACELEN) tracepos=0;
+        if (tracenum<TRACELEN) tracenum++;
+}
+#endif
+
+#if WIFISTATS
+static MCWSTAT stats[STATCMDS];
+static MCWSTAT *statcmd=NULL;  //statistics of last command sent
+static unsigned long stattime; //micros at last command sent
+static uint8_t statpend=0;     //1 if answer not yet received
+
+static MCWSTAT* statFind(uint8_t code,uint8_t add)
+{
+        uint8_t i;
+        for (i=0;i<STATCMDS;i++)
+        {
+          if (stats[i].code==code) return &stats[i];
+          if (stats[i].code==0) 
+           {if (!add) return NULL;stats[i].code=code;return &stats[i];}
+        }
+        return NULL;
+}
+
+static void statSend(uint8_t code)
+{
+        statcmd=statFind(code,1);
+        if (statcmd==NULL) {statpend=0;return;}  //table full
+        statcmd->count++;
+        stattime=micros();statpend=1;
+}
+
+static void statAnswer(uint8_t code)
+{
+        if ((!statpend)|(code==1)) return;       //async event is not the answer
+        statpend=0;
+        if ((code==0xFD)|(code==0xFE)) {statcmd->timeouts++;return;}
+        if (code==0xFF) {statcmd->errors++;return;}
+        unsigned long ms=(micros()-stattime)/1000;
+        uint8_t bin=0;
+        while ((ms>0)&(bin<STATBINS-1)) {ms=ms>>1;bin++;}
+        statcmd->hist[bin]++;
+}
+#endif
+
+/*
+* Frame sent to MCW (for debug trace and statistics)
+*/
+static inline void frameSent(uint8_t code,uint16_t len)
+{
+        #if WIFIDEBUG
+        traceFrame('>',code,len,TRACEOK);
+        #endif
+        #if WIFISTATS
+        statSend(code);
+        #endif
+}
 
 SoftwareSerialWIFI WIFISerial(RXPIN,TXPIN); //RX,TX
 
+#if WIFICAPTURE
+/*
+* Capture of WIFISerial traffic (both directions).
+* Log format: "MWCAP" + version (1), then records:
+*   tag: bit 7 direction (1 from MCW, 0 to MCW), bits 0-6 data length
+*   micros of first byte (4 bytes little endian)
+*   data bytes
+* Tag 0 is followed by 2 bytes count of lost bytes (buffer overflow)
+*/
+static uint8_t capbuff[CAPTLEN];
+static int capn=0;             //bytes in capbuff
+static int caprec=-1;          //position of tag of open record (-1 none)
+static uint16_t caplost=0;     //bytes lost
+static uint8_t capsk=0xFF;     //sink socket (0xFF Serial)
+static uint8_t capon=0;        //capture active
+
+static void capSerialFlush()
+{
+        Serial.write(capbuff,capn);
+        capn=0;caprec=-1;
+}
+
+static void capByte(uint8_t dir,uint8_t b)
+{
+        if (!capon) return;
+        if ((caprec>=0)&&((capbuff[caprec]&0x80)==dir)&&((capbuff[caprec]&0x7F)<127)
+           &&(capn<CAPTLEN))
+          {capbuff[capn++]=b;capbuff[caprec]++;return;}   //same record
+        if (capn+6>CAPTLEN)                                //no room for new record
+        {
+          if (capsk==0xFF) capSerialFlush();
+          else {caprec=-1;caplost++;return;}                //wait for flushCapture
+        }
+        unsigned long t=micros();
+        caprec=capn;
+        capbuff[capn++]=dir|1;
+        memcpy(&capbuff[capn],&t,4);capn+=4;
+        capbuff[capn++]=b;
+}
+#endif
+
+/*
+* Byte level access to WIFISerial (captured if WIFICAPTURE)
+*/
+static inline void mcwWrite(uint8_t b)
+{
+        WIFISerial.write(b);
+        #if WIFICAPTURE
+        capByte(0,b);
+        #endif
+}
+
+static inline uint8_t mcwRead()
+{
+        uint8_t b=WIFISerial.read();
+        #if WIFICAPTURE
+        capByte(0x80,b);
+        #endif
+        return b;
+}
+
+static inline int mcwDrain(uint8_t *buff,int len)
+{
+        int n=WIFISerial.drain(buff,len);
+        #if WIFICAPTURE
+        int i;for (i=0;i<n;i++) capByte(0x80,buff[i]);
+        #endif
+        return n;
+}
+
 
 /************************************* Main functions ********************************************/
 
@@ -73,6 +223,9 @@ void MWiFi::begin()
          setSockSize();
          setARP(0);
          errorHandle=NULL;
+         yieldHandle=NULL;
+         inyield=0;
+         linkowner=NULL;
 }
 
 /*
@@ -480,7 +633,7 @@ uint8_t MWiFi::openSockTCP(char *ipremote,uint16_t port)
            receiveMessWait(1000);               //response 25: response to cmd 113
            if (rxcode==25)
             {ok=rxmbuff[0];if (ok!=0xFE) break;}// 0xFE : connection in progress
-           delay(100);
+           pause(100,(250UL-i)*100);
           }
           if ((ok==0xFF)|(ok==0xFE)) {closeSock(socket);return 0xFF;} //0xFF : no connection
           return socket;
@@ -503,7 +656,7 @@ uint8_t MWiFi::openServerTCP(uint16_t port)
           if (rxcode==24) if (rxmbuff[2]>0) return 0XFF;
           uint8_t mess2[2];
           mess2[0]=socket;
-          mess2[1]=1;
+          mess2[1]=BACKLOG;
           sendLongMess(114,mess2,2);          //cmd 114: on listening status
           uint8_t i;
           for(i=0;i<250;i++)
@@ -511,7 +664,7 @@ uint8_t MWiFi::openServerTCP(uint16_t port)
            receiveMessWait(1000);                //response 26: response to cmd 114
            if (rxcode==26) {ok=rxmbuff[0];        // 0xFE : connection in progress
            if (ok!=0xFE) break;}
-           delay(100);
+           pause(100,(250UL-i)*100);
           }
           if ((ok==0xFF)|(ok==0xFE)) {closeSock(socket);return 0xFF;} //0xFF : no connection
           return socket;          
@@ -590,18 +743,9 @@ uint16_t MWiFi::writeDataLnPM(uint8_t sk,prog_char *buffer)
 */
 uint16_t MWiFi::readData(uint8_t sk,uint8_t *buffer,uint16_t lbuff)
 {
-          uint16_t bread=0;
-          uint16_t lb=lbuff;
-          if (buffer==NULL) lb=0;
-          uint8_t mess[4];
-          mess[0]=sk;
-          mess[1]=0;
-          memcpy(&mess[2],&lb,2);
-          sendLongMess(117,mess,4);          //cmd 117: receive data
+          recvStart(sk,(buffer==NULL)?0:lbuff);
           receiveMessWait(10000);              //response 29: response to cmd 117
-          if (rxcode==29) {memcpy(&bread,&rxmbuff[2],2);}
-          if (buffer==NULL) return bread;
-          else {memcpy(buffer,&rxmbuff[4],bread);return bread;}
+          return recvEnd(buffer);
 }
 char* MWiFi::readDataLn(uint8_t sk)
 {
@@ -617,7 +761,7 @@ char* MWiFi::readDataLn(int sk, int millis)
           char *rec=NULL;
           int i;
           for (i=0;i<n;i++)
-                {rec=readLine(sk);if (rec!=NULL) break;else delay(10);}
+                {rec=readLine(sk);if (rec!=NULL) break;else pause(10,(n-i)*10UL);}
           return rec;
 }
 
@@ -628,6 +772,7 @@ char* MWiFi::readDataLn(int sk, int millis)
 void MWiFi::closeSock(uint8_t sk)
 {
  //         cleanBuff(sk);
+          if (sk==lbsk) {next=0;frb=0;lbsk=-1;}   //its data in linebuff
           uint8_t mess[2]={0,0};
           mess[0]=sk;
           sendLongMess(111,mess,2);        //cmd 111: close socket
@@ -635,6 +780,188 @@ void MWiFi::closeSock(uint8_t sk)
 }
 
 
+/*********************************  Task Functions ***********************************************/
+
+/*
+* Tasks share the MCW link one command at a time: a task locks the link, 
+* sends its command and keeps the link until the answer is arrived 
+* (pollAnswer), so answers can't be mixed. Other tasks wait for the link.
+*/
+uint8_t MWiFi::lockLink(void *owner)
+{
+          if ((linkowner!=NULL)&&(linkowner!=owner)) return 0;
+          linkowner=owner;
+          return 1;
+}
+
+void MWiFi::unlockLink(void *owner)
+{
+          if (linkowner==owner) linkowner=NULL;
+}
+
+bool MWiFi::linkFree()
+{
+          return (linkowner==NULL);
+}
+
+/*
+* Not blocking receiveMessWait: it returns MCWPENDING until the answer to the
+* command sent at tstart arrives (async events are decoded meanwhile).
+* Then it returns answer code (rxcode); 0xFD if no answer after ms millisec.
+*/
+uint8_t MWiFi::pollAnswer(unsigned long tstart,unsigned long ms)
+{
+          if (inyield) {rxcode=0xFD;return rxcode;}
+          if (WIFISerial.available()>0)
+          {
+            receiveMess();
+            if ((rxcode!=1)&&(rxcode!=0xFD))
+            {
+              #if WIFISTATS
+              statAnswer(rxcode);
+              #endif
+              return rxcode;
+            }
+          }
+          if (millis()-tstart>ms)
+          {
+            rxcode=0xFD;
+            #if WIFIDEBUG
+            traceFrame('<',rxcode,0,TRACENOANS);
+            #endif
+            #if WIFISTATS
+            statAnswer(rxcode);
+            #endif
+            return rxcode;
+          }
+          return MCWPENDING;
+}
+
+/*
+* Task version of Connect() (after ConnSetOpen or ConnSetWPA).
+* Result: 1 connected, 0 not connected.
+* It keeps the link while connecting (no other command before connection).
+*/
+uint8_t MWiFi::ConnectTask(WIFITASK *t)
+{
+          PT_BEGIN(&t->pt);
+          t->res=0;
+          PT_WAIT_UNTIL(&t->pt,lockLink(t));
+          {uint8_t mess[2]={1,0};sendLongMess(90,mess,2);}   //cmd 90: connect
+          t->t=millis();
+          PT_WAIT_UNTIL(&t->pt,(t->code=pollAnswer(t->t,1000))!=MCWPENDING);  //ACK
+          CONNSTATUS=0;
+          IP[0]=0;IP[1]=0;IP[2]=0;IP[3]=0;
+          t->t=millis();
+          PT_WAIT_UNTIL(&t->pt,(pollAnswer(t->t,CONNTOUT*1000UL),
+                                (CONNSTATUS!=0)||(millis()-t->t>CONNTOUT*1000UL)));
+          if (CONNSTATUS==1)
+          {
+           t->t=millis();
+           PT_WAIT_UNTIL(&t->pt,(pollAnswer(t->t,CONNTOUT*1000UL),
+                                 (IP[0]!=0)||(millis()-t->t>CONNTOUT*1000UL)));
+          }
+          if (CONNSTATUS==1) {setLed(1,1);t->res=1;} else setLed(1,0);
+          unlockLink(t);
+          PT_END(&t->pt);
+}
+
+/*
+* Task version of openSockTCP().
+* Result: socket if connection ok; 0xFF if it can't open socket.
+* ipremote and port must be the same at each call.
+*/
+uint8_t MWiFi::openSockTCPTask(WIFITASK *t,char *ipremote,uint16_t port)
+{
+          PT_BEGIN(&t->pt);
+          t->res=0xFF;
+          PT_WAIT_UNTIL(&t->pt,lockLink(t));
+          {uint8_t mess[2]={1,0};sendLongMess(110,mess,2);}  //cmd 110: allocate socket
+          t->t=millis();
+          PT_WAIT_UNTIL(&t->pt,(t->code=pollAnswer(t->t,2000))!=MCWPENDING);
+          t->sk=(t->code==23)?rxmbuff[0]:0xFE;
+          unlockLink(t);
+          if (t->sk>=0xFE) PT_EXIT(&t->pt);
+          t->step=0xFE;
+          for (t->n=0;t->n<250;t->n++)
+          {
+           PT_WAIT_UNTIL(&t->pt,lockLink(t));
+           {
+            int rip[4]={0,0,0,0};
+            sscanf(ipremote,"%3d.%3d.%3d.%3d",&rip[0],&rip[1],&rip[2],&rip[3]);
+            uint8_t mess2[20];memset(mess2,0,20);
+            mess2[0]=t->sk;
+            memcpy(&mess2[2],&port,2);
+            uint8_t i;for (i=0;i<4;i++) mess2[4+i]=(uint8_t)rip[i];
+            sendLongMess(113,mess2,20);        //command 113: connect to IP and remote Port
+           }
+           t->t=millis();
+           PT_WAIT_UNTIL(&t->pt,(t->code=pollAnswer(t->t,1000))!=MCWPENDING);
+           unlockLink(t);
+           if (t->code==25)
+            {t->step=rxmbuff[0];if (t->step!=0xFE) break;}  // 0xFE : connection in progress
+           t->t=millis();
+           PT_WAIT_UNTIL(&t->pt,millis()-t->t>=100);
+          }
+          if ((t->step==0xFF)|(t->step==0xFE))               //0xFF : no connection
+          {
+           PT_WAIT_UNTIL(&t->pt,lockLink(t));
+           closeSock(t->sk);
+           unlockLink(t);
+           PT_EXIT(&t->pt);
+          }
+          t->res=t->sk;
+          PT_END(&t->pt);
+}
+
+/*
+* Task version of writeData() and writeDataPM().
+* Result (n field): bytes really sent. Buffer must be unchanged until end.
+*/
+uint8_t MWiFi::writeDataTask(WIFITASK *t,uint8_t sk,uint8_t *buffer,uint16_t lbuff)
+{
+          PT_BEGIN(&t->pt);
+          t->n=0;
+          PT_WAIT_UNTIL(&t->pt,lockLink(t));
+          beginData(sk,lbuff);putData(buffer,lbuff);endData();
+          t->t=millis();
+          PT_WAIT_UNTIL(&t->pt,(t->code=pollAnswer(t->t,30000))!=MCWPENDING);
+          t->n=dataSent();
+          unlockLink(t);
+          PT_END(&t->pt);
+}
+
+uint8_t MWiFi::writeDataPMTask(WIFITASK *t,uint8_t sk,prog_char *buffer,uint16_t lbuff)
+{
+          PT_BEGIN(&t->pt);
+          t->n=0;
+          PT_WAIT_UNTIL(&t->pt,lockLink(t));
+          beginData(sk,lbuff);putDataPM(buffer,lbuff);endData();
+          t->t=millis();
+          PT_WAIT_UNTIL(&t->pt,(t->code=pollAnswer(t->t,30000))!=MCWPENDING);
+          t->n=dataSent();
+          unlockLink(t);
+          PT_END(&t->pt);
+}
+
+/*
+* Task version of readData().
+* Result (n field): bytes read (0 if none available).
+*/
+uint8_t MWiFi::readDataTask(WIFITASK *t,uint8_t sk,uint8_t *buffer,uint16_t lbuff)
+{
+          PT_BEGIN(&t->pt);
+          t->n=0;
+          PT_WAIT_UNTIL(&t->pt,lockLink(t));
+          recvStart(sk,lbuff);
+          t->t=millis();
+          PT_WAIT_UNTIL(&t->pt,(t->code=pollAnswer(t->t,10000))!=MCWPENDING);
+          t->n=recvEnd(buffer);
+          unlockLink(t);
+          PT_END(&t->pt);
+}
+
+
 /*********************************  Setting Functions ********************************************/
 
 /*
@@ -816,15 +1143,132 @@ void MWiFi::printAsync(int ev)
           case 255: Serial.print("ERROR : ");Serial.println(ERRORTYPE);break;       
         }
 }
+
+/*
+* Frame trace dump. One record per line (older first):
+* micros direction code length result
+* On Serial or on socket sk. Frames sent by dump itself are not traced.
+*/
+void MWiFi::dumpTrace()
+{
+        dumpTrace(0xFF);
+}
+
+void MWiFi::dumpTrace(uint8_t sk)
+{
+        char line[32];
+        traceon=0;
+        uint8_t n=tracenum;
+        uint8_t p=(tracepos+TRACELEN-n)%TRACELEN;
+        while(n>0)
+        {
+          TRACEREC *r=&trace[p];
+          snprintf(line,32,"%lu %c %u %u %u",r->time,r->dir,r->code,r->len,r->res);
+          if (sk==0xFF) Serial.println(line);
+          else writeDataLn(sk,line);
+          if (++p>=TRACELEN) p=0;
+          n--;
+        }
+        traceon=1;
+}
+
+void MWiFi::clearTrace()
+{
+        tracepos=0;tracenum=0;
+}
+#endif
+
+#if WIFICAPTURE
+/*
+* Start capture of WIFISerial traffic on Serial (no socket) or on socket sk.
+* Serial: log is written as soon as capture buffer is full.
+* Socket: log is kept in capture buffer until flushCapture(); bytes exceeding
+* buffer are lost (a record with lost bytes count is added).
+*/
+void MWiFi::startCapture()
+{
+        startCapture(0xFF);
+}
+
+void MWiFi::startCapture(uint8_t sk)
+{
+        capsk=sk;caprec=-1;caplost=0;
+        memcpy(capbuff,"MWCAP",5);capbuff[5]=1;capn=6;
+        capon=1;
+}
+
+/*
+* Send capture buffer to its sink. Traffic of flush itself is not captured.
+*/
+void MWiFi::flushCapture()
+{
+        if (capn==0) return;
+        if (capsk==0xFF) {capSerialFlush();return;}
+        uint8_t on=capon;
+        capon=0;
+        sendFromMem(capsk,capbuff,capn,0);
+        capn=0;caprec=-1;
+        if (caplost>0) {capbuff[0]=0;memcpy(&capbuff[1],&caplost,2);capn=3;caplost=0;}
+        capon=on;
+}
+
+void MWiFi::stopCapture()
+{
+        flushCapture();
+        capon=0;
+}
+#endif
+
+#if WIFISTATS
+/*
+* Statistics of command code (NULL if command never sent)
+*/
+MCWSTAT* MWiFi::getStats(uint8_t code)
+{
+        return statFind(code,0);
+}
+
+/*
+* Statistics dump. One line for each command sent:
+* code count errors timeouts empty | histogram (bins <1 <2 <4 ... ms)
+* On Serial or on socket sk.
+*/
+void MWiFi::dumpStats()
+{
+        dumpStats(0xFF);
+}
+
+void MWiFi::dumpStats(uint8_t sk)
+{
+        char line[64];
+        MCWSTAT st;
+        uint8_t i,j,p;
+        for (i=0;i<STATCMDS;i++)
+        {
+          if (stats[i].code==0) break;
+          st=stats[i];            //copy: dump on socket updates statistics
+          snprintf(line,64,"%3u %5u %5u %5u %5u |",st.code,st.count,st.errors,st.timeouts,st.empty);
+          if (sk==0xFF) Serial.print(line);else writeData(sk,line);
+          p=0;
+          for (j=0;(j<STATBINS)&(p<58);j++) p+=snprintf(&line[p],64-p," %u",st.hist[j]);
+          if (sk==0xFF) Serial.println(line);else writeDataLn(sk,line);
+        }
+}
+
+void MWiFi::resetStats()
+{
+        memset(stats,0,sizeof(stats));
+        statpend=0;
+}
 #endif
 
 void MWiFi::setSockSize()
 {
           uint8_t mess[10];
-          mess[0]=1;                          //1 server socket
-          mess[1]=2;                          //2 client socket
-          uint16_t v20=2000;
-          uint16_t v10=1000;
+          mess[0]=SRVSOCKS;                   //server sockets
+          mess[1]=CLISOCKS;                   //client sockets
+          uint16_t v20=SRVBUFF;
+          uint16_t v10=CLIBUFF;
           memcpy(&mess[2],&v20,2);            // server rx buff
           memcpy(&mess[4],&v20,2);            // server tx buff
           memcpy(&mess[6],&v10,2);            // client rx buff
@@ -838,17 +1282,13 @@ void MWiFi::setSockSize()
 */
 void MWiFi::sendShortMess(uint8_t code)
 {
+        if (inyield) return;
 	      PREAMBLE[2]=code;
 	      memset(&PREAMBLE[3],0,3);
-	      int i;for (i=0;i<6;i++) WIFISerial.write(PREAMBLE[i]);
-	      WIFISerial.write(0x45);
-	      uint8_t ev=getAsync();     //eventually read async mess (simulate polling)
-        #if WIFIDEBUG
-        if(ev!=0) printAsync(ev);
-        Serial.print(" > ");
-        for (i=0;i<6;i++)   {Serial.print(PREAMBLE[i],HEX);Serial.print(" ");}
-                             Serial.print(0x45,HEX);Serial.println();        
-        #endif
+	      int i;for (i=0;i<6;i++) mcwWrite(PREAMBLE[i]);
+	      mcwWrite(0x45);
+        frameSent(code,0);
+	      getAsync();                //eventually read async mess (simulate polling)
 
 }
 
@@ -857,15 +1297,12 @@ void MWiFi::sendShortMess(uint8_t code)
 */
 void MWiFi::sendGPMessage(int gp,int s)
 {
+        if (inyield) return;
         GPIOMESS[6]=(uint8_t)gp;
         GPIOMESS[7]=(uint8_t)s;
-	      int i;for (i=0;i<9;i++) WIFISerial.write(GPIOMESS[i]);
-        uint8_t ev=getAsync();     //eventually read async mess (simulate polling)
-        #if WIFIDEBUG
-        if(ev!=0) printAsync(ev);
-        Serial.print(" > ");
-        for (i=0;i<6;i++)   {Serial.print(GPIOMESS[i],HEX);Serial.print(" ");}
-        #endif
+	      int i;for (i=0;i<9;i++) mcwWrite(GPIOMESS[i]);
+        frameSent(GPIOMESS[2],2);
+        getAsync();                //eventually read async mess (simulate polling)
 	      
 }
 
@@ -877,20 +1314,15 @@ void MWiFi::sendGPMessage(int gp,int s)
 */
 void MWiFi::sendLongMess(uint8_t code,uint8_t *buff,uint16_t len)
 {
+        if (inyield) return;
        	PREAMBLE[2]=code;PREAMBLE[3]=0;
         memcpy(&PREAMBLE[4],&len,2);
         int i;
-        for (i=0;i<6;i++)   WIFISerial.write(PREAMBLE[i]);
-        for (i=0;i<len;i++) WIFISerial.write(buff[i]);
-                            WIFISerial.write(0x45);
-        uint8_t ev=getAsync();     //eventually read async mess (simulate polling)
-        #if WIFIDEBUG
-        if(ev!=0) printAsync(ev);
-        Serial.print(" > ");
-        for (i=0;i<6;i++)   {Serial.print(PREAMBLE[i],HEX);Serial.print(" ");}
-        for (i=0;i<len;i++) {Serial.print(buff[i],HEX);Serial.print(" ");}
-                             Serial.print(0x45,HEX);Serial.println();        
-        #endif
+        for (i=0;i<6;i++)   mcwWrite(PREAMBLE[i]);
+        for (i=0;i<len;i++) mcwWrite(buff[i]);
+                            mcwWrite(0x45);
+        frameSent(code,len);
+        getAsync();                //eventually read async mess (simulate polling)
 }
 
 
@@ -911,6 +1343,34 @@ int MWiFi::getTimeout()
         else return 0;
 }
 
+/*
+* Millisec before time out
+*/
+unsigned long MWiFi::getRemaining()
+{
+        unsigned long t=millis();
+        if (stimer>t) return stimer-t;
+        else return 0;
+}
+
+/*
+* Wait of ms millisec inside library waiting loops. 
+* If yieldHandle is set, it is called (with remain: millisec before time out)
+* and then only the rest of ms is waited. 
+* Library is not re-entered: while yieldHandle runs, every command returns at
+* once as not answered (see inyield).
+*/
+void MWiFi::pause(unsigned long ms,unsigned long remain)
+{
+        if ((yieldHandle==NULL)||inyield) {delay(ms);return;}
+        unsigned long t=millis();
+        inyield=1;
+        yieldHandle(remain);
+        inyield=0;
+        t=millis()-t;
+        if (t<ms) delay(ms-t);
+}
+
 /*
 * Receive function from WIFISerial with timeout.
 * It waits until first byte is available on WIFISerial, or time out. 
@@ -918,24 +1378,39 @@ int MWiFi::getTimeout()
 */
 int MWiFi::receiveMessWait(unsigned long ms)
 {
-        setTimer(ms);
         rxcode=0xFD;
+        if (inyield) return rxcode;        //no library use inside yieldHandle
+        setTimer(ms);
         while(WIFISerial.available()==0)
-          {delay(10);if(getTimeout()) {return rxcode;}}
-        return receiveMess();
+          {pause(10,getRemaining());if(getTimeout()) {
+           #if WIFIDEBUG
+           traceFrame('<',rxcode,0,TRACENOANS);
+           #endif
+           #if WIFISTATS
+           statAnswer(rxcode);
+           #endif
+           return rxcode;}}
+        receiveMess();
+        #if WIFISTATS
+        statAnswer(rxcode);
+        #endif
+        return rxcode;
 }
 
 /*
 * Called by receiveMessWait function when first byte is available.
-* But it has 1 sec for complete message receiving.
+* But it has 4 sec for complete message receiving (and RXGAP ms between bytes).
 * Then it detects code and data length. With this length it creates buffer to receive data.
 * The buffer is rxmbuff and its length rxlmbuff.
+* Header and trailer are decoded byte by byte; payload is copied in bulk from
+* WIFISerial buffer (drain) as soon as its length is known.
 * The trailer is detected for message validating.
 * It returns the code. But it is also available as rxcode variable.
 */
 int MWiFi::receiveMess()
 {
         uint8_t b=0;
+        if (inyield) {rxcode=0xFD;return rxcode;}
         rxcode=0xFD;
         rxlmbuff=0 ;
         free(rxmbuff);
@@ -943,28 +1418,34 @@ int MWiFi::receiveMess()
         pbyte=0;
         int e=0;
         setTimer(4000);
-        while(WIFISerial.available()>0)
+        unsigned long tgap=millis();
+        while(1)
         {
-          delayMicroseconds(100);
-          b=WIFISerial.read();
-          readMess(b,&e);
-          #if WIFIDEBUG
-          Serial.print(b,HEX);Serial.print(" ");
-          #endif
-          if (e<0) break;
-          if (getTimeout()) 
-           {rxcode=0xFE;rxlmbuff=0;rxmbuff=NULL;
+          if ((pbyte>=6)&&(rxmbuff!=NULL)&&(pbyte<rxlmbuff+6))
+          {                                     //payload: bulk copy
+            int n=mcwDrain(&rxmbuff[pbyte-6],rxlmbuff+6-pbyte);
+            if (n>0) {pbyte=pbyte+n;tgap=millis();continue;}
+          }
+          else if (WIFISerial.available()>0)
+          {                                     //header and trailer
+            b=mcwRead();
+            readMess(b,&e);
+            if (e<0) break;
+            tgap=millis();
+            continue;
+          }
+          else if (pbyte==0) break;             //no message started
+          if (getTimeout()||(millis()-tgap>RXGAP)) 
+           {rxcode=0xFE;rxlmbuff=0;free(rxmbuff);rxmbuff=NULL;
            #if WIFIDEBUG
-           Serial.print("Code: ");Serial.println(rxcode,HEX);
+           traceFrame('<',rxcode,pbyte,TRACETOUT);
            #endif  
            return rxcode;}
         }
-        if (rxcode==1) decodeAsync();
         #if WIFIDEBUG 
-        if (rxcode==1){Serial.print("Event: ");Serial.println(rxmbuff[0],HEX);}
-        if (rxcode==0){Serial.println("Code: ACK");}
-        else if ((rxcode!=0xFD)&(rxcode!=1)) {Serial.print("Code: ");Serial.println(rxcode,HEX);} 
+        if (pbyte>0) traceFrame('<',rxcode,rxlmbuff,(rxcode==0xFF)?TRACEBAD:TRACEOK);
         #endif        
+        if (rxcode==1) decodeAsync();
         return rxcode;
 }
 
@@ -980,8 +1461,8 @@ void MWiFi::readMess(uint8_t b,int *e)
           case 1: if (b==0xAA) pbyte=2;break;
           case 2: rxcode=b;pbyte=3;break;
           case 3: if (b==0x80) {rxcode=0;};pbyte=4;break;
-          case 4: memcpy(&rxlmbuff,&b,1);pbyte=5;break;
-          case 5: memcpy(&rxlmbuff+1,&b,1);pbyte=6;
+          case 4: ((uint8_t*)&rxlmbuff)[0]=b;pbyte=5;break;
+          case 5: ((uint8_t*)&rxlmbuff)[1]=b;pbyte=6;
                   if (rxlmbuff>0) {rxmbuff=(uint8_t*)malloc(rxlmbuff);};break;
           case 6: if (b==0x45) {*e=-1;rxmbuff=NULL;break;}
           default:if (pbyte<rxlmbuff+6) {rxmbuff[pbyte-6]=b;pbyte++;break;} 
@@ -1028,10 +1509,11 @@ uint8_t MWiFi::decodeAsync()
 */
 uint8_t MWiFi::getAsyncWait(unsigned long ms)
 {
-         setTimer(ms);
          uint8_t cd=0;
+         if (inyield) return cd;
+         setTimer(ms);
          while(WIFISerial.available()==0)
-          {delay(10);if(getTimeout()) {return cd;}}
+          {pause(10,getRemaining());if(getTimeout()) {return cd;}}
          return getAsync();
 }
 
@@ -1066,44 +1548,74 @@ uint8_t MWiFi::createSockTCP()
 
 uint16_t MWiFi::sendFromMem(uint8_t sk,uint8_t *buffer,uint16_t lbuff,uint8_t ln)
 {
-          uint16_t bsent=0;
-          int len=lbuff+4;
-          if (ln) len++;
-       	  PREAMBLE[2]=116;PREAMBLE[3]=0;      //cmd 116: send data
-          memcpy(&PREAMBLE[4],&len,2);
-          int i,tbuff=lbuff;
-          uint8_t info[4];
-          info[0]=sk;info[1]=0;
-          if (ln) tbuff++; 
-          memcpy(&info[2],&tbuff,2);
-          for (i=0;i<6;i++)     WIFISerial.write(PREAMBLE[i]);
-          for (i=0;i<4;i++)     WIFISerial.write(info[i]);
-          for (i=0;i<lbuff;i++) WIFISerial.write(buffer[i]);
-          if (ln)               WIFISerial.write('\n');
-                                WIFISerial.write(0x45);
+          if (inyield) return 0;
+          beginData(sk,ln?lbuff+1:lbuff);
+          putData(buffer,lbuff);
+          if (ln) putData((uint8_t*)"\n",1);
+          endData();
           receiveMessWait(30000);                //response 28: response to cmd 116
-          if (rxcode==28) memcpy(&bsent,rxmbuff,2);
-          return bsent;
+          return dataSent();
 }
 
 uint16_t MWiFi::sendFromProgMem(uint8_t sk,prog_char *pgbuffer,uint16_t lbuff,uint8_t ln)
 {
-          uint16_t bsent=0;
-          int len=lbuff+4;
-          if (ln) len++;
+          if (inyield) return 0;
+          beginData(sk,ln?lbuff+1:lbuff);
+          putDataPM(pgbuffer,lbuff);
+          if (ln) putData((uint8_t*)"\n",1);
+          endData();
+          receiveMessWait(30000);                //response 28: response to cmd 116
+          return dataSent();
+}
+
+/*
+* Frame of cmd 116 (send data) written piece by piece, without buffer.
+* beginData writes header for lbuff data bytes on socket sk; then putData and
+* putDataPM must write exactly lbuff bytes; endData writes trailer.
+* Answer 28 must be then received (dataSent returns bytes really sent).
+* Called from yieldHandle the whole frame is dropped (another command is
+* waiting for its answer) and dataSent returns 0.
+*/
+void MWiFi::beginData(uint8_t sk,uint16_t lbuff)
+{
+          framedrop=(inyield!=0);
+          if (framedrop) return;
+          framelen=lbuff+4;
        	  PREAMBLE[2]=116;PREAMBLE[3]=0;      //cmd 116: send data
-          memcpy(&PREAMBLE[4],&len,2);
-          int i,tbuff=lbuff;;
+          memcpy(&PREAMBLE[4],&framelen,2);
           uint8_t info[4];
           info[0]=sk;info[1]=0;
-          if (ln) tbuff++;
-          memcpy(&info[2],&tbuff,2);
-          for (i=0;i<6;i++)     WIFISerial.write(PREAMBLE[i]);
-          for (i=0;i<4;i++)     WIFISerial.write(info[i]);
-          for (i=0;i<lbuff;i++) WIFISerial.write(pgm_read_byte(pgbuffer+i));
-          if (ln)               WIFISerial.write('\n');
-                                WIFISerial.write(0x45);
-          receiveMessWait(30000);                //response 28: response to cmd 116
+          memcpy(&info[2],&lbuff,2);
+          int i;
+          for (i=0;i<6;i++)     mcwWrite(PREAMBLE[i]);
+          for (i=0;i<4;i++)     mcwWrite(info[i]);
+}
+
+void MWiFi::putData(uint8_t *buffer,uint16_t lbuff)
+{
+          uint16_t i;
+          if (framedrop) return;
+          for (i=0;i<lbuff;i++) mcwWrite(buffer[i]);
+}
+
+void MWiFi::putDataPM(prog_char *buffer,uint16_t lbuff)
+{
+          uint16_t i;
+          if (framedrop) return;
+          for (i=0;i<lbuff;i++) mcwWrite(pgm_read_byte(buffer+i));
+}
+
+void MWiFi::endData()
+{
+          if (framedrop) return;
+          mcwWrite(0x45);
+          frameSent(116,framelen);
+}
+
+uint16_t MWiFi::dataSent()
+{
+          uint16_t bsent=0;
+          if (framedrop) return 0;
           if (rxcode==28) memcpy(&bsent,rxmbuff,2);
           return bsent;
 }
@@ -1119,25 +1631,142 @@ uint16_t MWiFi::sendFromProgMem(uint8_t sk,prog_char *pgbuffer,uint16_t lbuff,ui
 */
 
 char* MWiFi::readLine(int sk)
+{
+          char *line=lineBuffered(sk);         //line already received
+          if (line!=NULL) return line;
+          lineRecvStart(sk);
+          receiveMessWait(10000);              //response 29: response to cmd 117
+          return lineRecvEnd();
+}
+
+/*
+* readLine in two halves (used also by tasks): lineRecvStart shifts out the 
+* line already returned and asks data for the free part of linebuff 
+* (cmd 117); lineRecvEnd (after answer 29) appends data and returns next line
+* (or NULL).
+*/
+void MWiFi::lineRecvStart(int sk)
+{
+	if (sk!=lbsk) {next=0;frb=0;lbsk=sk;}  //data of another socket: dropped
+	lineShift();
+	recvStart(sk,LINEBUFFLEN-frb-1);
+}
+
+/*
+* Next line of sk if it is already complete in linebuff (no MCW command);
+* else NULL.
+*/
+char* MWiFi::lineBuffered(int sk)
+{
+	if (sk!=lbsk) return NULL;
+	lineShift();
+	char* lf=(char*)memchr(linebuff,'\n',frb);
+	if (lf==NULL) return NULL;
+	int plf=lf-linebuff;
+	next=plf+1;
+	linebuff[plf]='\0';
+	return linebuff;
+}
+
+void MWiFi::lineShift()
 {
 	if (next>0) 
 	{
 	  int i=0;for (i=0;i<frb;i++)
 	  {if ((i+next)>=frb) linebuff[i]='\0';	else linebuff[i]=linebuff[i+next];}
 	  frb=frb-next;
+	  next=0;
 	}
-	int len=LINEBUFFLEN-frb-1;
-	int cb=readData(sk,(uint8_t*)&linebuff[frb],len);
+}
+
+char* MWiFi::lineRecvEnd()
+{
+	int cb=recvEnd((uint8_t*)&linebuff[frb]);
 	frb=frb+cb;
 	if (frb==0){next=0;return NULL;}
 	int plf;
-	char* lf=(char*)memchr(linebuff,'\n',frb-1);
+	char* lf=(char*)memchr(linebuff,'\n',frb);
 	if (lf!=NULL) {plf=lf-linebuff;next=plf+1;}
 	else {plf=frb; next=plf;}
 	linebuff[plf]='\0';
   return linebuff;
 }
 
+/*
+* Reads max lbuff bytes following the lines read by readLine: first the ones
+* left in linebuff, then from socket. Returns bytes read.
+*/
+uint16_t MWiFi::readBuffData(int sk,uint8_t *buffer,uint16_t lbuff)
+{
+          uint16_t n=0;
+          if (sk==lbsk)
+          {
+            n=frb-next;if (n>lbuff) n=lbuff;
+            memcpy(buffer,&linebuff[next],n);
+            next=next+n;
+          }
+          if (n<lbuff) n=n+readData(sk,buffer+n,lbuff-n);
+          return n;
+}
+
+/*
+* Bytes of socket sk read and left in linebuff (not yet returned by readLine)
+*/
+int MWiFi::lineLeft(int sk)
+{
+          if (sk!=lbsk) return 0;
+          return frb-next;
+}
+
+/*
+* Raw data of socket sk through linebuff (for parsers): dataBuffered returns
+* bytes not yet used (reading them from socket if none left) and their 
+* number in len; dataConsumed marks n of them as used. Bytes not used stay
+* in linebuff for next reading.
+* lineRecvStart and dataRecvEnd: the same reading in two halves (for tasks).
+*/
+uint8_t* MWiFi::dataBuffered(int sk,int *len)
+{
+          if (sk!=lbsk) {next=0;frb=0;lbsk=sk;}
+          if (next>=frb) {next=0;frb=readData(sk,(uint8_t*)linebuff,LINEBUFFLEN-1);}
+          *len=frb-next;
+          return (uint8_t*)&linebuff[next];
+}
+
+void MWiFi::dataConsumed(int n)
+{
+          next=next+n;
+}
+
+void MWiFi::dataRecvEnd()
+{
+          frb=frb+recvEnd((uint8_t*)&linebuff[frb]);
+}
+
+/*
+* Cmd 117 (receive data) in two halves (used also by tasks): recvStart asks
+* max lbuff bytes of socket sk; recvEnd (after answer 29) copies data received
+* in buffer and returns their number.
+*/
+void MWiFi::recvStart(uint8_t sk,uint16_t lbuff)
+{
+          uint8_t mess[4];
+          mess[0]=sk;
+          mess[1]=0;
+          memcpy(&mess[2],&lbuff,2);
+          sendLongMess(117,mess,4);          //cmd 117: receive data
+}
+
+uint16_t MWiFi::recvEnd(uint8_t *buffer)
+{
+          uint16_t bread=0;
+          if (rxcode==29) {memcpy(&bread,&rxmbuff[2],2);}
+          #if WIFISTATS
+          if ((rxcode==29)&(bread==0)) {MCWSTAT *st=statFind(117,0);if (st!=NULL) st->empty++;}
+          #endif
+          if ((buffer!=NULL)&&(bread>0)) memcpy(buffer,&rxmbuff[4],bread);
+          return bread;
+}
 
 
 void MWiFi::cleanBuff(int sk)
@@ -1147,14 +1776,14 @@ void MWiFi::cleanBuff(int sk)
    {
     n=readData(sk,(uint8_t*)linebuff,LINEBUFFLEN-1);
     if (n>0) continue; 
-    else {delay(10);n=readData(sk,(uint8_t*)linebuff,LINEBUFFLEN-1);}
+    else {pause(10,10);n=readData(sk,(uint8_t*)linebuff,LINEBUFFLEN-1);}
    }
-   next=0;frb=0;
+   next=0;frb=0;lbsk=-1;
 }
 
 void MWiFi::resetBuff()
 {
-   next=0;frb=0;
+   next=0;frb=0;lbsk=-1;
 }
 
 void MWiFi::connectionLost()
@@ -47,9 +47,17 @@
 #include <Arduino.h>
 #include <utility/SoftwareSerialWIFI.h>
 #include <utility/EEPROM.h>
+#include <utility/PT.h>
 
 #define WIFIDEBUG 0        //for debug use only (use 1 for debugging)
+                           //frames are traced in a RAM ring (see dumpTrace)
+#define TRACELEN 24        //frames traced if WIFIDEBUG (9 RAM bytes each)
 #define ERRLOG 1           //serial output of error code(set 1 if you like it) 
+#define WIFISTATS 0        //statistics of MCW commands (use 1; see getStats)
+#define STATCMDS 12        //number of commands with statistics (if WIFISTATS)
+#define STATBINS 10        //latency histogram bins:<1,<2,<4...ms,>=256ms(last)
+#define WIFICAPTURE 0      //capture of traffic with MCW (use 1; see startCapture)
+#define CAPTLEN 128        //capture buffer length (if WIFICAPTURE)
 
 
 #define LINEBUFFLEN 84     //buffer length for reading data received as record
@@ -58,12 +66,56 @@
 
 #define CONNTOUT  60       //Time out for connection trying (in sec)
 
+// Sockets allocation on MCW (cmd 122 at begin). MCW has about 8000 bytes for
+// all socket buffers: reduce buffers if you increase sockets.
+#define SRVSOCKS 3         //server sockets (listening and accepted links)
+#define SRVBUFF 1000       //rx and tx buffer of each server socket (bytes)
+#define CLISOCKS 2         //client sockets (openSockTCP)
+#define CLIBUFF 500        //rx and tx buffer of each client socket (bytes)
+#define BACKLOG 3          //links waiting for accept on listening socket
+
 
 // Definitions for  SoftSerial internal communication
 #define RXPIN 2            //Pin used by SoftSerial(not available for other use)
 #define TXPIN 3            //Pin used by SoftSerial(not available for other use)
 #define WIFISPEED 57600    //SoftSerial bauds (internal communication with MCW) 
+#define RXGAP 50           //max silence (ms) between bytes of the same message
+
+
 
+// Statistics of one MCW command (WIFISTATS)
+typedef struct
+{
+  uint8_t code;              //command code (0: free slot)
+  uint16_t count;            //commands sent
+  uint16_t errors;           //answers without trailer
+  uint16_t timeouts;         //answers not arrived or incomplete
+  uint16_t empty;            //answers without data (cmd 117 with 0 bytes)
+  uint16_t hist[STATBINS];   //latency from command sent to answer:
+                             //bin 0 <1ms, bin i <2^i ms, last bin any more
+} MCWSTAT;
+
+// State of a task (see Task functions). PT_INIT(&task.pt) before first call
+typedef struct
+{
+  PT pt;                     //task continuation
+  uint8_t res;               //task result (when ended)
+  uint8_t sk;                //socket used by task
+  uint8_t code;              //answer code of last command
+  uint8_t step;              //free for task use
+  int n;                     //bytes read or sent
+  int i;                     //free for task use
+  int l;                     //free for task use
+  unsigned long t;           //time of last command sent (or of wait start)
+} WIFITASK;
+
+#define MCWPENDING 0xFC    //answer not yet arrived (pollAnswer)
+
+// Trace record results (WIFIDEBUG)
+#define TRACEOK    0       //frame sent or received
+#define TRACETOUT  1       //frame started but not completed in time
+#define TRACEBAD   2       //frame without trailer
+#define TRACENOANS 3       //no answer in time (receiveMessWait)
 
 
 class MWiFi
@@ -94,6 +146,16 @@ public:
                              // N.B. assign after begin function call
                              // because begin function assign to NULL
 
+    void (*yieldHandle)(unsigned long);
+                             // default : yieldHandle = NULL ;
+                             // if yieldHandle = any customer function
+                             // this function is called (about every 10ms)
+                             // while library waits for MCW answers or 
+                             // data, with millisec left before time out.
+                             // Library can't be used inside this function
+                             // (commands return at once as not answered)
+                             // N.B. assign after begin function call
+
 /********************************** Main functions ****************************/
 
 /*
@@ -299,6 +361,32 @@ public:
     void closeSock(uint8_t sk);
 
 
+/*********************************  Task Functions ****************************/
+
+/*
+* Resumable (not blocking) versions of main functions, as protothreads 
+* (see utility/PT.h). A task function does its work a step at a time: it 
+* returns PT_WAITING while operation is in progress and PT_ENDED (or 
+* PT_EXITED if failed) when done, with results in task state (WIFITASK).
+* Task state must be initialized by PT_INIT(&task.pt) before first call, then
+* the function must be called again (with the same arguments) at each loop 
+* (scheduler tick) until it ends. Example:
+*   if (WIFI.openSockTCPTask(&tk,ip,80)>=PT_EXITED) {sk=tk.res;...}
+* More tasks (also of HTTP and MAIL) can run together: they share the MCW link
+* one command at a time. Blocking functions can be called only when no task 
+* is waiting for an answer (linkFree() true).
+*/
+    uint8_t ConnectTask(WIFITASK *t);                      //res: 1 connected
+    uint8_t openSockTCPTask(WIFITASK *t,char *ipremote,uint16_t port);
+                                                           //res: socket/0xFF
+    uint8_t writeDataTask(WIFITASK *t,uint8_t sk,uint8_t *buffer,uint16_t lbuff);
+    uint8_t writeDataPMTask(WIFITASK *t,uint8_t sk,prog_char *buffer,uint16_t lbuff);
+                                                           //n: bytes sent
+    uint8_t readDataTask(WIFITASK *t,uint8_t sk,uint8_t *buffer,uint16_t lbuff);
+                                                           //n: bytes read
+    bool linkFree();
+
+
 /*********************************  Setting Functions *************************/
 
 /*
@@ -383,6 +471,56 @@ public:
 
     void setARP(uint16_t sec);
 
+#if WIFIDEBUG
+/*
+* Debug only. Every frame to/from MCW is recorded in a RAM ring of TRACELEN
+* records: time (micros), direction ('>' to MCW, '<' from MCW), command or
+* response code, data length and result (see TRACEOK...).
+* Recording costs a few cycles, so timing is not changed as by Serial printing.
+* dumpTrace() prints records (older first) on Serial, one record per line:
+*   micros direction code length result
+* dumpTrace(sk) sends the same lines on socket sk.
+* HostTools/tracedecode.py turns these lines into a timeline.
+*/
+    void dumpTrace();
+    void dumpTrace(uint8_t sk);
+    void clearTrace();
+#endif
+
+#if WIFISTATS
+/*
+* Command statistics (WIFISTATS 1). For each MCW command code (up to STATCMDS
+* codes) it counts commands sent, errors, timeouts, empty answers and a log 
+* scale histogram of latency from command sent to its answer.
+* getStats returns statistics of command code (NULL if never sent).
+* dumpStats() prints one line for each command on Serial:
+*   code count errors timeouts empty | histogram bins
+* dumpStats(sk) sends the same lines on socket sk.
+* If WIFISTATS is 0 nothing is compiled.
+*/
+    MCWSTAT* getStats(uint8_t code);
+    void dumpStats();
+    void dumpStats(uint8_t sk);
+    void resetStats();
+#endif
+
+#if WIFICAPTURE
+/*
+* Traffic capture (WIFICAPTURE 1). Every byte exchanged with MCW (both 
+* directions) is recorded with timestamps in a compact binary log.
+* startCapture() writes the log on Serial (use a fast speed: 115200 or more,
+* and no other print while capturing).
+* startCapture(sk) sends the log on socket sk, but only when flushCapture() is
+* called (for example in loop); if capture buffer (CAPTLEN) gets full before,
+* the exceeding bytes are lost and a lost count is put in the log.
+* HostTools/mcwcap.py saves, shows and replays the log.
+*/
+    void startCapture();
+    void startCapture(uint8_t sk);
+    void flushCapture();
+    void stopCapture();
+#endif
+
 protected:
 
     uint8_t MAC[6];
@@ -400,6 +538,8 @@ protected:
     uint8_t *rxmbuff; 
     int pbyte;
     unsigned long stimer; //Used by timer
+    uint8_t inyield;      //1 while yieldHandle runs
+    void *linkowner;      //task using MCW link (NULL: free)
  
     char* netscn;
     char* ssidscn;
@@ -418,6 +558,33 @@ protected:
 * When end of data it returns NULL
 */
     char* readLine(int sk);
+
+/*
+* readLine in two halves: lineRecvStart sends cmd 117 for free part of 
+* linebuff, lineRecvEnd (after answer) returns next line (or NULL)
+*/
+    void lineRecvStart(int sk);
+    char* lineRecvEnd();
+
+/*
+* Data following lines read (left in linebuff first, then from socket) and 
+* number of bytes left in linebuff. linebuff holds data of one socket at a 
+* time: readLine on another socket (or closeSock) drops them.
+*/
+    uint16_t readBuffData(int sk,uint8_t *buffer,uint16_t lbuff);
+    int lineLeft(int sk);
+    char* lineBuffered(int sk);     //next line if complete in linebuff
+    void lineShift();               //drops line returned from linebuff
+
+/*
+* Raw data through linebuff (for parsers): dataBuffered gives bytes not yet
+* used (len), reading from socket if none left; dataConsumed marks n bytes 
+* used (the others stay for next reading). dataRecvEnd is the half after
+* lineRecvStart (for tasks).
+*/
+    uint8_t* dataBuffered(int sk,int *len);
+    void dataConsumed(int n);
+    void dataRecvEnd();
     
 
 #if WIFIDEBUG
@@ -457,6 +624,17 @@ void setSockSize();
 */
     int getTimeout();
 
+/*
+* Millisec before time out
+*/
+    unsigned long getRemaining();
+
+/*
+* Wait ms millisec calling yieldHandle (if any) with remain millisec 
+* before time out. Used by every waiting loop.
+*/
+    void pause(unsigned long ms,unsigned long remain);
+
 /*
 * Receive function from WIFISerial with timeout.
 * It waits until first byte is available on WIFISerial, or time out. 
@@ -509,6 +687,36 @@ void setSockSize();
     
     uint16_t sendFromMem(uint8_t sk,uint8_t *buffer,uint16_t lbuff,uint8_t ln);    
     uint16_t sendFromProgMem(uint8_t sk,prog_char *pgbuffer,uint16_t lbuff,uint8_t ln);
+
+/*
+* Cmd 116 frame written in pieces: beginData (header for lbuff bytes), 
+* putData/putDataPM (exactly lbuff bytes in all), endData (trailer).
+* After answer 28, dataSent returns bytes really sent.
+*/
+    void beginData(uint8_t sk,uint16_t lbuff);
+    void putData(uint8_t *buffer,uint16_t lbuff);
+    void putDataPM(prog_char *buffer,uint16_t lbuff);
+    void endData();
+    uint16_t dataSent();
+
+/*
+* Cmd 117 in two halves: recvStart asks max lbuff bytes; recvEnd (after 
+* answer 29) copies them in buffer and returns their number
+*/
+    void recvStart(uint8_t sk,uint16_t lbuff);
+    uint16_t recvEnd(uint8_t *buffer);
+
+/*
+* Link sharing between tasks (owner: task state)
+*/
+    uint8_t lockLink(void *owner);
+    void unlockLink(void *owner);
+
+/*
+* Not blocking wait of answer to command sent at tstart (millis): 
+* MCWPENDING until answer, 0xFD if time out (ms).
+*/
+    uint8_t pollAnswer(unsigned long tstart,unsigned long ms);
     
     void cleanBuff(int sk);
     void resetBuff();
@@ -0,0 +1,70 @@
+/*
+* This example reads analog values A1 and A2 every TIMEINT seconds and 
+* uploads them NREC at a time on a client session: the NREC requests are 
+* written one after the other on the kept link (pipelining) and then their
+* responses are read in order, so the batch costs about one round trip
+* instead of NREC.
+*
+* Data are sent with POST method as records: valAna1 valAna2
+* (see HTTPClient example and its PC program for the server side)
+*
+* Author: Daniele Denaro
+*/
+
+#include <HTTPlib.h>             // include library
+
+/********* Definitions (adapt to your environment) **********************/
+
+#define ACCESSPOINT  "D-Link-casa"       // access point name
+#define PASSWORD     ""                  // password if WAP
+#define REMOTEIP     "192.168.1.2"       // PC computer address
+#define PORT         8080                // application port
+
+#define TIMEINT      1                   // time interval in seconds
+#define NREC         4                   // records sent in a batch
+#define AN1           1                  // input analogical A1
+#define AN2           2                  // input analogical A2
+
+/*************************************************************************/
+
+int fc=0;                      // flag connection
+
+HTTP WIFI;                     //instance of MWiFi library
+HTTPSESSION ss;                // client session (link kept between requests)
+
+char rec[NREC][12];            // records of batch
+char *recs[NREC];
+int nrec=0;
+
+void setup() 
+{
+  Serial.begin(9600);
+  WIFI.begin();                // startup wifi shield
+  if (PASSWORD==""){WIFI.ConnSetOpen(ACCESSPOINT);}         // if passw= empty string connect in open mode
+  else             {WIFI.ConnSetWPA(ACCESSPOINT,PASSWORD);} // else connect in WAP mode
+  int i;for(i=0;i<5;i++) {fc=WIFI.Connect(); if(fc) break;}  // try to connect for 5 times
+  if (!fc) {Serial.println("No connection!");return;}
+  Serial.println("Net connected!");
+  for (i=0;i<NREC;i++) recs[i]=rec[i];
+  WIFI.sessionBegin(&ss,REMOTEIP,PORT);             // link opened by first request
+} 
+
+void loop() 
+{
+  if (!fc) return;
+  sprintf(rec[nrec],"%d %d",analogRead(AN1),analogRead(AN2));
+  nrec++;
+  if (nrec==NREC)
+  {
+    int n=WIFI.sessionBatch(&ss,HPPOST,"/TestWIFIArduino/TestClient",recs,NREC,status,5000);
+    Serial.print("Answered ");Serial.print(n);Serial.print(" of ");Serial.println(NREC);
+    nrec=0;
+  }
+  delay(TIMEINT*1000);
+}
+
+void status(int i,int code)    // called for each response, in order
+{
+  Serial.print("Record ");Serial.print(i);
+  Serial.print(" status ");Serial.println(code);
+}
@@ -0,0 +1,76 @@
+/*
+* This example demonstrates how to download a long file (for example a 
+* firmware image or a data table) with a small buffer: the body is given to
+* a function a block at a time, as it arrives, and download ends exactly at
+* its last byte (Content-Length or chunked response).
+*
+* Every TIMEINT seconds the example asks REMOTEIP:PORT for RESOURCE, prints
+* status, type and length, and computes a simple checksum of the body (put
+* here your code saving blocks, for example in a SD file or external flash).
+*
+* Author: Daniele Denaro
+*/
+
+#include <HTTPlib.h>             // include library
+
+/********* Definitions (adapt to your environment) **********************/
+
+#define ACCESSPOINT  "D-Link-casa"       // access point name
+#define PASSWORD     ""                  // password if WAP
+#define REMOTEIP     "192.168.1.2"       // server address
+#define PORT         8080                // server port
+#define RESOURCE     "/firmware.bin"     // file to download
+
+#define TIMEINT      60                  // time interval in seconds
+
+/*************************************************************************/
+
+int fc=0;                      // flag connection
+
+HTTP WIFI;                     //instance of MWiFi library
+
+uint8_t block[64];             // buffer for body blocks
+unsigned int checksum;
+
+void setup() 
+{
+  Serial.begin(9600);
+  WIFI.begin();                // startup wifi shield
+  if (PASSWORD==""){WIFI.ConnSetOpen(ACCESSPOINT);}         // if passw= empty string connect in open mode
+  else             {WIFI.ConnSetWPA(ACCESSPOINT,PASSWORD);} // else connect in WAP mode
+  int i;for(i=0;i<5;i++) {fc=WIFI.Connect(); if(fc) break;}  // try to connect for 5 times
+  if (!fc) {Serial.println("No connection!");return;}
+  Serial.println("Net connected!");
+} 
+
+void saveBlock(uint8_t *data,int len)                 // called for each block of body
+{
+  int i;for (i=0;i<len;i++) checksum=checksum+data[i];
+}
+
+void loop() 
+{
+  if (!fc) return;
+  int csocket=WIFI.openSockTCP(REMOTEIP,PORT);
+  if (csocket==255) {Serial.println("Socket not available!");delay(TIMEINT*1000);return;}
+  WIFI.sendRequestGET(csocket,RESOURCE);
+  int code=WIFI.getResponseHead(csocket,5000);       // status and headers
+  if (code==200)
+  {
+    Serial.print(WIFI.Response.ctype);Serial.print(" length: ");
+    if (WIFI.Response.chunked) Serial.println("chunked");
+    else Serial.println(WIFI.Response.clen);
+    checksum=0;
+    long n=WIFI.getResponseBody(csocket,saveBlock,block,sizeof(block));
+    if (n<0) Serial.println("Download not complete");
+    else {Serial.print(n);Serial.print(" bytes, checksum ");Serial.println(checksum);}
+  }
+  else if (code>0)
+  {
+    Serial.print("Status ");Serial.println(code);
+    WIFI.getResponseBody(csocket,NULL,block,sizeof(block));  // body dropped
+  }
+  else Serial.println("No answer");
+  WIFI.closeSock(csocket);
+  delay(TIMEINT*1000);
+}
@@ -0,0 +1,58 @@
+/*
+* This example sends analog values A1 and A2 to a web application every 
+* TIMEINT seconds on a client session: the TCP link is opened by the first
+* request and kept (keep-alive), so next uploads don't open a socket again.
+* If the server closes the link (or it is idle too long) the library opens
+* it again by itself.
+*
+* Data are sent with POST method as a record: valAna1 valAna2
+* (see HTTPClient example and its PC program for the server side)
+*
+* Author: Daniele Denaro
+*/
+
+#include <HTTPlib.h>             // include library
+
+/********* Definitions (adapt to your environment) **********************/
+
+#define ACCESSPOINT  "D-Link-casa"       // access point name
+#define PASSWORD     ""                  // password if WAP
+#define REMOTEIP     "192.168.1.2"       // PC computer address
+#define PORT         8080                // application port
+
+#define TIMEINT      2                   // time interval in seconds
+#define AN1           1                  // input analogical A1
+#define AN2           2                  // input analogical A2
+
+/*************************************************************************/
+
+int fc=0;                      // flag connection
+
+HTTP WIFI;                     //instance of MWiFi library
+HTTPSESSION ss;                // client session (link kept between requests)
+
+char rec[24];                  // record sent
+uint8_t buff[16];              // buffer for response body
+
+void setup() 
+{
+  Serial.begin(9600);
+  WIFI.begin();                // startup wifi shield
+  if (PASSWORD==""){WIFI.ConnSetOpen(ACCESSPOINT);}         // if passw= empty string connect in open mode
+  else             {WIFI.ConnSetWPA(ACCESSPOINT,PASSWORD);} // else connect in WAP mode
+  int i;for(i=0;i<5;i++) {fc=WIFI.Connect(); if(fc) break;}  // try to connect for 5 times
+  if (!fc) {Serial.println("No connection!");return;}
+  Serial.println("Net connected!");
+  WIFI.sessionBegin(&ss,REMOTEIP,PORT);             // link opened by first request
+} 
+
+void loop() 
+{
+  if (!fc) return;
+  sprintf(rec,"%d %d",analogRead(AN1),analogRead(AN2));
+  int code=WIFI.sessionRequest(&ss,HPPOST,"/TestWIFIArduino/TestClient",rec,5000);
+  if (code>0) WIFI.getResponseBody(ss.sk,NULL,buff,sizeof(buff));   // body dropped
+  Serial.print("Status ");Serial.print(code);
+  Serial.print(" requests on link ");Serial.println(ss.nreq);
+  delay(TIMEINT*1000);
+}
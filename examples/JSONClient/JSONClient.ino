@@ -0,0 +1,73 @@
+/*
+* This example demonstrates how to read values from a JSON answer of a REST
+* service without storing the answer: the library parser (JSONPARSER) gets
+* the body in small pieces as it arrives and copies only the selected values.
+*
+* Every TIMEINT seconds the example asks REMOTEIP:PORT for RESOURCE and 
+* prints the values of paths "main.temp", "weather.0.description" and "name"
+* of an answer like:
+*   {"weather":[{"description":"clear sky"}],"main":{"temp":21.5},"name":"Rome"}
+*
+* Author: Daniele Denaro
+*/
+
+#include <HTTPlib.h>             // include library
+
+/********* Definitions (adapt to your environment) **********************/
+
+#define ACCESSPOINT  "D-Link-casa"       // access point name
+#define PASSWORD     ""                  // password if WAP
+#define REMOTEIP     "192.168.1.2"       // REST service address
+#define PORT         8080                // service port
+#define RESOURCE     "/weather"          // resource giving JSON
+
+#define TIMEINT      60                  // time interval in seconds
+
+/*************************************************************************/
+
+int fc=0;                      // flag connection
+
+HTTP WIFI;                     //instance of MWiFi library
+
+prog_char pTemp[] PROGMEM="main.temp";             // paths of selected values
+prog_char pDesc[] PROGMEM="weather.0.description";
+prog_char pName[] PROGMEM="name";
+
+char temp[8];                  // buffers for selected values
+char desc[32];
+char name[16];
+
+void setup() 
+{
+  Serial.begin(9600);
+  WIFI.begin();                // startup wifi shield
+  if (PASSWORD==""){WIFI.ConnSetOpen(ACCESSPOINT);}         // if passw= empty string connect in open mode
+  else             {WIFI.ConnSetWPA(ACCESSPOINT,PASSWORD);} // else connect in WAP mode
+  int i;for(i=0;i<5;i++) {fc=WIFI.Connect(); if(fc) break;}  // try to connect for 5 times
+  if (!fc) {Serial.println("No connection!");return;}
+  Serial.println("Net connected!");
+} 
+
+void loop() 
+{
+  if (!fc) return;
+  int csocket=WIFI.openSockTCP(REMOTEIP,PORT);
+  if (csocket==255) {Serial.println("Socket not available!");delay(TIMEINT*1000);return;}
+  JSONPARSER jp;
+  jp.begin();                                        // new document
+  jp.select(pTemp,temp,sizeof(temp));                // values to extract
+  jp.select(pDesc,desc,sizeof(desc));
+  jp.select(pName,name,sizeof(name));
+  WIFI.sendRequestGET(csocket,RESOURCE);
+  int r=WIFI.getResponseJSON(csocket,&jp,5000);
+  if (r==JPDONE)
+  {
+    Serial.print(name);Serial.print(": ");Serial.print(temp);
+    Serial.print(" ");Serial.println(desc);
+    if (!(jp.found&2)) Serial.println("(no description)");   // bit of second select
+  }
+  else if (r==JPERROR) Serial.println("Not JSON answer");
+  else Serial.println("No answer");
+  WIFI.closeSock(csocket);
+  delay(TIMEINT*1000);
+}
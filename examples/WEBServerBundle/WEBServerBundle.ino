@@ -0,0 +1,60 @@
+/*
+* This example makes a WEB server whose files (HTML, CSS, JS in web folder)
+* are put in flash by webbundle.py: minified, gzip compressed, with ETag
+* (browser asks again and gets a short 304 answer) and with route table.
+*
+* After changing web folder or routes.txt make web.h again:
+*   python3 HostTools/webbundle.py web --routes routes.txt -o web.h
+*
+* index.html has a tag @ (A1 value), so it is a dynamic page: its function
+* page_index_html is written here. Static files have functions made by
+* webbundle.py. pA1 (AJAX answer) is in routes.txt.
+*
+* Author: Daniele Denaro
+*/
+
+#include <HTTPlib.h>             // include library (HTTP library is a derivate class of WiFi)
+
+#define ACCESSPOINT  "D-Link-casa"       // access point name
+#define PASSWORD     ""                  // password if WAP
+#define PORT         80                  // server listening port
+
+char ip[16];                   // buffer for (dynamic) ip address as string
+boolean fc=0;                  // flag connection
+
+HTTP WIFI;                     //instance of MWiFi library
+
+#include "web.h"               // web files and route table made by webbundle.py
+
+void setup()
+{
+  Serial.begin(9600);
+  WIFI.begin();                                      // startup wifi shield
+  if (PASSWORD=="") {fc=WIFI.ConnectOpen(ACCESSPOINT);}
+  else              {fc=WIFI.ConnectWPAwithPsw(ACCESSPOINT,PASSWORD);}
+  if (!fc) {Serial.println("No connection!");return;}
+  WIFI.getIP(ip);
+  Serial.print("Net Connected as ");Serial.println(ip);
+  WIFI.setRoutes(NROUTES,routes,routes_slots,NROUTES_SLOTS);   // route table of web.h
+  if (WIFI.startServer(PORT)==255) {Serial.println("Socket problem!");fc=0;return;}
+  Serial.print("Server active on port ");Serial.println(PORT);
+}
+
+void loop()
+{
+  if (fc) WIFI.serveRequests(0,NULL);
+}
+
+/********************* Page Functions ***************************/
+void page_index_html(char *query)
+{
+  char *val[1];
+  char val0[5];sprintf(val0,"%d",analogRead(1));val[0]=val0;
+  WIFI.sendDynResponse(WIFI.Resource.sk,&index_html,1,val);
+}
+
+void pA1(char *query)
+{
+  char val0[5];sprintf(val0,"%d",analogRead(1));
+  WIFI.sendShortResponse(WIFI.Resource.sk,val0);
+}
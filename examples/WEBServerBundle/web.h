@@ -0,0 +1,77 @@
+// Web bundle made by webbundle.py from web: don't edit, run it again.
+
+extern HTTP WIFI;
+
+// app.js: 202 bytes, gzip 182 (1.1x)
+const uint8_t app_js_data[] PROGMEM={
+  0x1F,0x8B,0x08,0x00,0x00,0x00,0x00,0x00,0x02,0x03,0x35,0x8E,0x31,0x0B,0x83,0x30,
+  0x14,0x84,0xF7,0xFC,0x8A,0x6C,0x89,0x20,0xA9,0xCE,0xD2,0xC1,0x42,0xA9,0x82,0x2E,
+  0xC5,0xA1,0x6B,0x30,0xCF,0x22,0xD8,0x17,0x9B,0xBC,0x58,0x4B,0xF1,0xBF,0x57,0x2D,
+  0x9D,0xEE,0x86,0xFB,0xEE,0xAE,0x0B,0xD8,0x52,0x6F,0x91,0x3B,0xD0,0x26,0x4F,0x65,
+  0xC4,0x3F,0x6C,0xD2,0x8E,0xCF,0xFC,0xC8,0x11,0x5E,0xFC,0x56,0x57,0x05,0xD1,0x78,
+  0x85,0x67,0x00,0x4F,0x32,0xCA,0xD8,0xAC,0x2C,0x0E,0x56,0x9B,0x35,0xD0,0xFD,0xE1,
+  0x1D,0x33,0xB6,0x0D,0x0F,0x40,0x52,0x77,0xA0,0xF3,0x00,0x9B,0x3D,0xBD,0x4B,0x23,
+  0x85,0x4E,0x45,0xA4,0x7A,0x44,0x70,0x45,0x53,0x57,0x2B,0x37,0x2B,0x07,0x7E,0xB4,
+  0xE8,0xA1,0x81,0x99,0x32,0xB6,0xEC,0xAD,0x23,0xA0,0x14,0x97,0x73,0x23,0x62,0x2E,
+  0x0E,0x79,0xBA,0x0A,0xB9,0x00,0xFB,0xA2,0x07,0x34,0xDB,0xF6,0xC2,0x3C,0x50,0x89,
+  0x04,0x6E,0xD2,0x83,0xFC,0x5D,0x8E,0x79,0x9A,0x24,0x49,0x94,0x7D,0x01,0x6F,0x07,
+  0x5E,0x3E,0xCA,0x00,0x00,0x00
+};
+const WEBASSET app_js PROGMEM={(prog_char*)app_js_data,182,NULL,0,ASSETJS,ASSETGZIP,0x3E5E076FUL,0UL};
+
+void web_app_js(char *query) {WIFI.sendAsset(WIFI.Resource.sk,&app_js);}
+
+// Page made by pagecompile.py from index.html: don't edit, run it again.
+// 217 bytes, 1 tags
+
+prog_char index_html_text[] PROGMEM=
+"<html> <head> <title>Arduino Server</title> <link rel=\"stylesheet\" hre"
+"f=\"/style.css\"> <script src=\"/app.js\"></script> </head> <body> <h1>W"
+"elcome to Arduino Server</h1> <p>Analog A1: <b id=\"a1\"></b></p> </body"
+"> </html>";
+
+const uint16_t index_html_segs[] PROGMEM={193,217};
+
+const DYNPAGE index_html PROGMEM={index_html_text,index_html_segs,217,2,0x00000000UL};
+
+// style.css: 153 bytes, gzip 139 (1.1x)
+const uint8_t style_css_data[] PROGMEM={
+  0x1F,0x8B,0x08,0x00,0x00,0x00,0x00,0x00,0x02,0x03,0x4D,0x8D,0xC1,0x0A,0xC2,0x30,
+  0x10,0x44,0x7F,0x25,0xE0,0xB5,0x81,0x8D,0x88,0x48,0x72,0xF2,0xE6,0x6F,0x6C,0xD2,
+  0xA4,0x2E,0xA6,0x49,0xD9,0xB4,0x62,0x0D,0xFD,0x77,0xA3,0xA0,0xC8,0xDC,0xDE,0xBC,
+  0x61,0x6C,0xEE,0xD7,0x1A,0x72,0x9A,0x65,0xC0,0x91,0xE2,0xAA,0xC5,0x99,0x09,0x63,
+  0x77,0xF1,0xF1,0xEE,0x67,0x72,0xD8,0x15,0x4C,0x45,0x16,0xCF,0x14,0x8C,0x45,0x77,
+  0x1B,0x38,0x2F,0xA9,0x97,0x2E,0xC7,0xCC,0x5A,0xEC,0x02,0xBC,0x63,0x46,0xE4,0x81,
+  0x92,0x16,0x7B,0x98,0x1E,0xDB,0x55,0xD5,0x6F,0xAD,0xE0,0x08,0x08,0xE6,0x73,0x50,
+  0xE8,0xE9,0x9B,0x71,0x68,0xC6,0x54,0xFF,0x88,0x3A,0x35,0x62,0x7F,0x13,0x04,0xD5,
+  0xB2,0xBD,0x00,0x31,0x55,0xD3,0x96,0x99,0x00,0x00,0x00
+};
+const WEBASSET style_css PROGMEM={(prog_char*)style_css_data,139,NULL,0,ASSETCSS,ASSETGZIP,0x96D35531UL,0UL};
+
+void web_style_css(char *query) {WIFI.sendAsset(WIFI.Resource.sk,&style_css);}
+
+// /index: write void page_index_html(char *query) in sketch (1 tags:
+// sendDynResponse(WIFI.Resource.sk,&index_html,1,param))
+
+// Route table made by routegen.py: don't edit, run it again.
+
+void web_app_js(char *query);
+void web_style_css(char *query);
+void pA1(char *query);
+void page_index_html(char *query);
+
+prog_char routes_0[] PROGMEM="/app.js";
+prog_char routes_1[] PROGMEM="/style.css";
+prog_char routes_2[] PROGMEM="/A1";
+prog_char routes_3[] PROGMEM="/index";
+
+const WEBROUTE routes[] PROGMEM={
+  {0x1BFC,HPGET,routes_0,web_app_js},
+  {0x2950,HPGET,routes_1,web_style_css},
+  {0x37DA,HPGET,routes_2,pA1},
+  {0xB414,HPGET,routes_3,page_index_html}
+};
+#define NROUTES 4
+
+const uint8_t routes_slots[] PROGMEM={4,2,0,3,1};
+#define NROUTES_SLOTS 5
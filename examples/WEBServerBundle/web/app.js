@@ -0,0 +1,10 @@
+// reads A1 every second
+function readA1() {
+  var x = new XMLHttpRequest();
+  x.onload = function () {
+    document.getElementById('a1').innerHTML = x.responseText;
+  };
+  x.open('GET', '/A1', true);
+  x.send();
+}
+setInterval(readA1, 1000);
@@ -0,0 +1,94 @@
+/*
+* This example makes a WEB server answering AJAX requests with JSON.
+* Page asks /table every 2 seconds and shows the analog inputs as a table.
+*
+* JSON is written by the library JSON writer (JSONWRITER): values go in a
+* small buffer sent as chunks when full, so the answer can be longer than 
+* Arduino RAM (here 50 samples of 6 inputs).
+*
+* Author: Daniele Denaro
+*/
+
+#include <HTTPlib.h>             // include library (HTTP library is a derivate class of WiFi)
+
+#define ACCESSPOINT  "D-Link-casa"       // access point name
+#define PASSWORD     ""                  // password if WAP
+#define PORT         80                  // server listening port
+#define NSAMPLES     50                  // samples in JSON table
+
+char ip[16];                   // buffer for (dynamic) ip address as string
+boolean fc=0;                  // flag connection
+
+HTTP WIFI;                     //instance of MWiFi library
+
+/**************** HTML pages *****************/
+prog_char pageIndex[] PROGMEM=
+"<html><head>"
+"<title>Arduino Server</title>"
+"<script>"
+"function rd(){var x=new XMLHttpRequest();"
+"x.onload=function(){var d=JSON.parse(x.responseText),h='';"
+"d.samples.forEach(function(s){h+='<tr><td>'+s.join('</td><td>')+'</td></tr>';});"
+"document.getElementById('t').innerHTML=h;"
+"document.getElementById('ms').innerHTML=d.millis;};"
+"x.open('GET','/table',true);x.send();}"
+"setInterval(rd,2000);"
+"</script></head>"
+"<body>"
+"<h1>Analog inputs</h1>"
+"<p>millis: <b id='ms'></b></p>"
+"<table border='1' id='t'></table>"
+"</body></html>";
+
+/******************** end HTML Pages *********************/
+
+prog_char kMillis[] PROGMEM="millis";              // JSON keys in flash
+prog_char kSamples[] PROGMEM="samples";
+
+void pindex(char *query);
+void ptable(char *query);
+
+WEBRES rs[]={{"/index",pindex},{"/table",ptable}};
+
+void setup()
+{
+  Serial.begin(9600);
+  WIFI.begin();                                      // startup wifi shield
+  if (PASSWORD=="") {fc=WIFI.ConnectOpen(ACCESSPOINT);}
+  else              {fc=WIFI.ConnectWPAwithPsw(ACCESSPOINT,PASSWORD);}
+  if (!fc) {Serial.println("No connection!");return;}
+  WIFI.getIP(ip);
+  Serial.print("Net Connected as ");Serial.println(ip);
+  if (WIFI.startServer(PORT)==255) {Serial.println("Socket problem!");fc=0;return;}
+  Serial.print("Server active on port ");Serial.println(PORT);
+}
+
+void loop()
+{
+  if (fc) WIFI.serveRequests(2,rs);
+}
+
+/********************* Page Functions ***************************/
+void pindex(char *query)
+{
+  WIFI.sendResponse(WIFI.Resource.sk,pageIndex);
+}
+
+void ptable(char *query)
+{
+  int i,a;
+  JSONWRITER j;                                      // writer (JSONBUFF bytes)
+  WIFI.jsonBegin(&j,WIFI.Resource.sk);
+  WIFI.jsonObject(&j);                               // {"millis":...,"samples":[[..],..]}
+  WIFI.jsonKeyPM(&j,kMillis);
+  WIFI.jsonNumber(&j,millis());
+  WIFI.jsonKeyPM(&j,kSamples);
+  WIFI.jsonArray(&j);
+  for (i=0;i<NSAMPLES;i++)
+  {
+    WIFI.jsonArray(&j);
+    for (a=0;a<6;a++) WIFI.jsonNumber(&j,analogRead(a));
+    WIFI.jsonClose(&j);
+  }
+  WIFI.jsonEnd(&j);                                  // closes array and object, last chunk
+}
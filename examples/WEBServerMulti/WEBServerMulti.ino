@@ -0,0 +1,80 @@
+/*
+* This example makes a WEB server for more browsers (or tabs) at the same time.
+* Page shows analog value A1, refreshed by an AJAX request every second.
+*
+* Server is managed by library: startServer() opens the listening socket and
+* serveRequests() (called at each loop) accepts new links, reads whichever
+* link has a request and activates the corresponding function (WEBRES array),
+* as getRequest() does.
+* Function gets the socket of current request from WIFI.Resource.sk
+*
+* To serve more links together, MCW must have more server sockets:
+* see SRVSOCKS, SRVBUFF and BACKLOG in MWiFi.h (default 3, 1000, 3).
+*
+* Author: Daniele Denaro
+*/
+
+#include <HTTPlib.h>             // include library (HTTP library is a derivate class of WiFi)
+
+#define ACCESSPOINT  "D-Link-casa"       // access point name
+#define PASSWORD     ""                  // password if WAP
+#define PORT         80                  // server listening port
+
+char ip[16];                   // buffer for (dynamic) ip address as string
+boolean fc=0;                  // flag connection
+
+HTTP WIFI;                     //instance of MWiFi library
+
+/**************** HTML pages *****************/
+prog_char pageIndex[] PROGMEM=
+"<html><head>"
+"<title>Arduino Server</title>"
+"<script>"
+"function rd(){var x=new XMLHttpRequest();"
+"x.onload=function(){document.getElementById('a1').innerHTML=x.responseText;};"
+"x.open('GET','/A1',true);x.send();}"
+"setInterval(rd,1000);"
+"</script></head>"
+"<body>"
+"<h1>Welcome to Arduino Server</h1>"
+"<p>Analog A1: <b id='a1'>@</b></p>"              //@ tag for A1 value
+"</body></html>";
+
+/******************** end HTML Pages *********************/
+
+void pindex(char *query);
+void pA1(char *query);
+
+WEBRES rs[]={{"/index",pindex},{"/A1",pA1}};
+
+void setup()
+{
+  Serial.begin(9600);
+  WIFI.begin();                                      // startup wifi shield
+  if (PASSWORD=="") {fc=WIFI.ConnectOpen(ACCESSPOINT);}
+  else              {fc=WIFI.ConnectWPAwithPsw(ACCESSPOINT,PASSWORD);}
+  if (!fc) {Serial.println("No connection!");return;}
+  WIFI.getIP(ip);
+  Serial.print("Net Connected as ");Serial.println(ip);
+  if (WIFI.startServer(PORT)==255) {Serial.println("Socket problem!");fc=0;return;}
+  Serial.print("Server active on port ");Serial.println(PORT);
+}
+
+void loop()
+{
+  if (fc) WIFI.serveRequests(2,rs);   // one call serves at most one request
+}
+
+/********************* Page Functions ***************************/
+void pindex(char *query)
+{
+  char *val[1];
+  char val0[5];sprintf(val0,"%d",analogRead(1));val[0]=val0;
+  WIFI.sendDynResponse(WIFI.Resource.sk,pageIndex,1,val);
+}
+
+void pA1(char *query)
+{
+  char val0[5];sprintf(val0,"%d",analogRead(1));
+  WIFI.sendShortResponse(WIFI.Resource.sk,val0);
+}
@@ -0,0 +1,78 @@
+/*
+* This example makes a WEB server using a route table in PROGMEM instead of
+* a WEBRES array: route names don't use RAM and are found by hash.
+*
+* Routes are listed in routes.txt and routes.h is made by
+*   python3 HostTools/routegen.py routes.txt -o routes.h
+* Route "/led/+" matches "/led/on" and "/led/off": the segment is given by
+* WIFI.routeArg(0). Other methods than GET and POST get 405 answer.
+*
+* Author: Daniele Denaro
+*/
+
+#include <HTTPlib.h>             // include library (HTTP library is a derivate class of WiFi)
+#include "routes.h"              // route table made by routegen.py
+
+#define ACCESSPOINT  "D-Link-casa"       // access point name
+#define PASSWORD     ""                  // password if WAP
+#define PORT         80                  // server listening port
+#define LED          13                  // led pin
+
+char ip[16];                   // buffer for (dynamic) ip address as string
+boolean fc=0;                  // flag connection
+
+HTTP WIFI;                     //instance of MWiFi library
+
+/**************** HTML pages *****************/
+prog_char pageIndex[] PROGMEM=
+"<html><head><title>Arduino Server</title></head>"
+"<body>"
+"<h1>Welcome to Arduino Server</h1>"
+"<p>Analog A1: @</p>"                              //@ tag for A1 value
+"<p><a href='/led/on'>Led on</a> <a href='/led/off'>Led off</a></p>"
+"</body></html>";
+
+/******************** end HTML Pages *********************/
+
+void setup()
+{
+  Serial.begin(9600);
+  pinMode(LED,OUTPUT);
+  WIFI.begin();                                      // startup wifi shield
+  if (PASSWORD=="") {fc=WIFI.ConnectOpen(ACCESSPOINT);}
+  else              {fc=WIFI.ConnectWPAwithPsw(ACCESSPOINT,PASSWORD);}
+  if (!fc) {Serial.println("No connection!");return;}
+  WIFI.getIP(ip);
+  Serial.print("Net Connected as ");Serial.println(ip);
+  WIFI.setRoutes(NROUTES,routes,routes_slots,NROUTES_SLOTS);   // route table instead of WEBRES
+  if (WIFI.startServer(PORT)==255) {Serial.println("Socket problem!");fc=0;return;}
+  Serial.print("Server active on port ");Serial.println(PORT);
+}
+
+void loop()
+{
+  if (fc) WIFI.serveRequests(0,NULL);   // routes set: no WEBRES array
+}
+
+/********************* Page Functions ***************************/
+void pindex(char *query)
+{
+  char *val[1];
+  char val0[5];sprintf(val0,"%d",analogRead(1));val[0]=val0;
+  WIFI.sendDynResponse(WIFI.Resource.sk,pageIndex,1,val);
+}
+
+void pA1(char *query)
+{
+  char val0[5];sprintf(val0,"%d",analogRead(1));
+  WIFI.sendShortResponse(WIFI.Resource.sk,val0);
+}
+
+void pled(char *query)
+{
+  char *cmd=WIFI.routeArg(0);                        // "on" or "off"
+  if (strcmp(cmd,"on")==0) digitalWrite(LED,HIGH);
+  else if (strcmp(cmd,"off")==0) digitalWrite(LED,LOW);
+  else {WIFI.respNOK(WIFI.Resource.sk);return;}
+  WIFI.sendShortResponse(WIFI.Resource.sk,cmd);
+}
@@ -0,0 +1,19 @@
+// Route table made by routegen.py: don't edit, run it again.
+
+void pA1(char *query);
+void pindex(char *query);
+void pled(char *query);
+
+prog_char routes_0[] PROGMEM="/A1";
+prog_char routes_1[] PROGMEM="/index";
+prog_char routes_2[] PROGMEM="/led/+";
+
+const WEBROUTE routes[] PROGMEM={
+  {0x37DA,HPGET,routes_0,pA1},
+  {0xB414,HPGET,routes_1,pindex},
+  {0x0000,HPGET|HPPOST,routes_2,pled}
+};
+#define NROUTES 3
+
+const uint8_t routes_slots[] PROGMEM={1,0,2};
+#define NROUTES_SLOTS 3
@@ -0,0 +1,329 @@
+/* ========================================================================== */
+/*                                                                            */
+/*   HTTP request parser                                                      */
+/*   (c) 2014 Author Daniele Denaro                                           */
+/*                                                                            */
+/*   Description                                                              */
+/*   See HTTPPARSER.h                                                         */
+/*                                                                            */
+/* ========================================================================== */
+
+#include <HTTPPARSER.h>
+
+// parser states
+#define HS_METHOD  0
+#define HS_PATH    1
+#define HS_QUERY   2
+#define HS_VERSION 3
+#define HS_HNAME   4
+#define HS_HSPACE  5
+#define HS_HVALUE  6
+#define HS_DONE    7
+#define HS_RVERSION 8      //response status line
+#define HS_RCODE   9
+#define HS_RREASON 10
+
+// headers decoded by parser (names lower case)
+#define HB_LEN   0
+#define HB_CONN  1
+#define HB_TENC  2
+#define HB_AENC  3
+
+prog_char hpLen[] PROGMEM="content-length";
+prog_char hpConn[] PROGMEM="connection";
+prog_char hpTEnc[] PROGMEM="transfer-encoding";
+prog_char hpAEnc[] PROGMEM="accept-encoding";
+
+prog_char hpMethods[] PROGMEM="GET POST PUT DELETE HEAD ";   //as HPGET...
+
+prog_char hpClose[] PROGMEM="close";
+prog_char hpKeep[] PROGMEM="keep-alive";
+prog_char hpChunked[] PROGMEM="chunked";
+prog_char hpGzip[] PROGMEM="gzip";
+
+
+/*
+* New request: path and query buffers (with their sizes) are filled by parse.
+* query can be NULL (query dropped). Watched headers are cleared.
+*/
+void HTTPPARSER::begin(char *path,uint8_t lpath,char *query,uint8_t lquery)
+{
+  this->path=path;this->lpath=lpath;
+  this->query=query;this->lquery=lquery;
+  path[0]='\0';
+  if (query!=NULL) query[0]='\0';
+  nwatch=0;
+  method=0;version=0;flags=0;clen=-1;
+  status=HPMORE;
+  state=HS_METHOD;np=0;nhead=0;
+}
+
+/*
+* New response (client side): status line instead of request line.
+*/
+void HTTPPARSER::beginResponse()
+{
+  path=NULL;lpath=0;query=NULL;lquery=0;
+  nwatch=0;
+  method=0;version=0;flags=0;clen=-1;code=0;
+  status=HPMORE;
+  state=HS_RVERSION;np=0;nhead=0;
+}
+
+/*
+* Value of header name (PROGMEM string, case insensitive) will be copied in
+* buff (null terminated); empty string if header not present.
+* Value longer than lbuff-1 is cut.
+*/
+void HTTPPARSER::watch(prog_char *name,char *buff,uint8_t lbuff)
+{
+  if (nwatch>=HPWATCH) return;
+  wname[nwatch]=name;wbuff[nwatch]=buff;wlen[nwatch]=lbuff;
+  buff[0]='\0';
+  nwatch++;
+}
+
+/*
+* Parses len bytes of data. Returns HPMORE, HPDONE or error (status).
+* used: bytes used; less than len if done or error.
+*/
+int HTTPPARSER::parse(uint8_t *data,int len,int *used)
+{
+  int i;
+  for (i=0;(i<len)&&(status==HPMORE);i++) status=step((char)data[i]);
+  if (used!=NULL) *used=i;
+  return status;
+}
+
+bool HTTPPARSER::started()
+{
+  return (nhead>0);
+}
+
+prog_char* HTTPPARSER::hname(uint8_t i)
+{
+  switch (i)
+  {
+    case HB_LEN: return hpLen;
+    case HB_CONN: return hpConn;
+    case HB_TENC: return hpTEnc;
+    case HB_AENC: return hpAEnc;
+  }
+  return wname[i-HPBUILTIN];
+}
+
+/*
+* Method bit of token (0 if unknown)
+*/
+static uint8_t methodCode(char *tok)
+{
+  uint8_t bit=1;
+  int k=0;
+  char c;
+  prog_char *p=hpMethods;
+  while ((c=pgm_read_byte(p++))!='\0')
+  {
+    if (c==' ') {if ((k>=0)&&(tok[k]=='\0')) return bit;bit=bit<<1;k=0;continue;}
+    if ((k>=0)&&(tok[k]==c)) k++; else k=-1;
+  }
+  return 0;
+}
+
+/*
+* One byte of request
+*/
+int HTTPPARSER::step(char c)
+{
+  uint8_t i;
+  if (++nhead>HPMAXHEAD)                       //limit of requests only
+    {if (path!=NULL) return HPHEADLONG; nhead=HPMAXHEAD;}
+  switch (state)
+  {
+    case HS_METHOD:
+      if ((c=='\r')||(c=='\n'))
+        {if (np==0) {nhead=0;return HPMORE;} else return HPBAD;} //empty lines
+      if (c==' ')
+      {
+        tok[np]='\0';
+        method=methodCode(tok);
+        if (method==0) return HPMETHOD;
+        state=HS_PATH;np=0;
+        return HPMORE;
+      }
+      if (np>=HPTOK-1) return HPMETHOD;
+      tok[np++]=c;
+      return HPMORE;
+
+    case HS_PATH:
+    case HS_QUERY:
+      if (c==' ')
+      {
+        if (state==HS_PATH) path[np]='\0'; else if (query!=NULL) query[np]='\0';
+        state=HS_VERSION;np=0;
+        return HPMORE;
+      }
+      if ((c=='?')&&(state==HS_PATH)) {path[np]='\0';state=HS_QUERY;np=0;return HPMORE;}
+      if ((uint8_t)c<' ') return HPBAD;
+      if (state==HS_PATH)
+        {if (np>=lpath-1) {path[np]='\0';return HPURILONG;} path[np++]=c;}
+      else if (query!=NULL)
+        {if (np>=lquery-1) {query[np]='\0';return HPURILONG;} query[np++]=c;}
+      return HPMORE;
+
+    case HS_VERSION:
+      if (c=='\r') return HPMORE;
+      if (c=='\n')
+      {
+        tok[np]='\0';
+        if ((np!=8)||(strncmp(tok,"HTTP/1.",7)!=0)) return HPBAD;
+        version=(tok[7]=='0')?10:11;
+        state=HS_HNAME;np=0;cand=0xFF;
+        return HPMORE;
+      }
+      if (np>=HPTOK-1) return HPBAD;
+      tok[np++]=c;
+      return HPMORE;
+
+    case HS_RVERSION:
+      if ((c=='\r')||(c=='\n'))
+        {if (np==0) {nhead=0;return HPMORE;} else return HPBAD;} //empty lines
+      if (c==' ')
+      {
+        tok[np]='\0';
+        if ((np!=8)||(strncmp(tok,"HTTP/1.",7)!=0)) return HPBAD;
+        version=(tok[7]=='0')?10:11;
+        state=HS_RCODE;np=0;
+        return HPMORE;
+      }
+      if (np>=HPTOK-1) return HPBAD;
+      tok[np++]=c;
+      return HPMORE;
+
+    case HS_RCODE:
+      if (isdigit((uint8_t)c))
+      {
+        if (np>=3) return HPBAD;
+        code=code*10+(c-'0');np++;
+        return HPMORE;
+      }
+      if (np!=3) return HPBAD;
+      state=HS_RREASON;
+    case HS_RREASON:                             //reason phrase skipped
+      if (c=='\n') {state=HS_HNAME;np=0;cand=0xFF;}
+      return HPMORE;
+
+    case HS_HNAME:
+      if (c=='\r') return HPMORE;
+      if (c=='\n')
+      {
+        if (np>0) return HPBAD;                  //header without ':'
+        if ((flags&HPCHUNKED)&&(clen>=0)) return HPBAD;  //ambiguous body length
+        state=HS_DONE;
+        return HPDONE;
+      }
+      if (c==':')
+      {
+        hidx=0xFF;
+        for (i=0;i<HPBUILTIN+nwatch;i++)
+          {if ((cand&(1<<i))&&(strlen_P(hname(i))==(size_t)np)) {hidx=i;break;}}
+        state=HS_HSPACE;np=0;nval=0;param=false;lastgz=false;
+        return HPMORE;
+      }
+      for (i=0;i<HPBUILTIN+nwatch;i++)          //names still matching
+      {
+        if ((cand&(1<<i))&&
+            (tolower((uint8_t)c)!=tolower(pgm_read_byte(hname(i)+np))))
+          cand&=~(1<<i);
+      }
+      np++;
+      return HPMORE;
+
+    case HS_HSPACE:
+      if ((c==' ')||(c=='\t')) return HPMORE;
+      state=HS_HVALUE;
+      return valueChar(c);
+
+    case HS_HVALUE:
+      return valueChar(c);
+  }
+  return HPBAD;
+}
+
+/*
+* One byte of header value
+*/
+int HTTPPARSER::valueChar(char c)
+{
+  uint8_t i;
+  if (c=='\r') return HPMORE;
+  if (c=='\n')                                 //end of header
+  {
+    if (hidx==HB_LEN)                          //repeated: same value only
+    {
+      if ((np==0)||((clen>=0)&&(clen!=nval))) return HPBAD;
+      clen=nval;
+    }
+    else if ((hidx==HB_CONN)||(hidx==HB_TENC)||(hidx==HB_AENC)) endToken();
+    else if ((hidx!=0xFF)&&(hidx>=HPBUILTIN)) wbuff[hidx-HPBUILTIN][np]='\0';
+    state=HS_HNAME;np=0;cand=0xFF;
+    return HPMORE;
+  }
+  switch (hidx)
+  {
+    case 0xFF: return HPMORE;                  //header not used
+    case HB_LEN:                               //np: digits (<0: digits ended)
+      if ((c==' ')||(c=='\t')) {if (np>0) np=-np;return HPMORE;}
+      if (!isdigit((uint8_t)c)||(np<0)) return HPBAD;
+      nval=nval*10+(c-'0');np++;
+      if (nval>99999999L) return HPBAD;
+      return HPMORE;
+    case HB_CONN:
+    case HB_TENC:
+    case HB_AENC:                              //list of tokens
+      if ((c==',')||(c==' ')||(c=='\t')||(c==';'))
+      {
+        endToken();np=0;
+        if (c==';') param=true;                //parameters of token follow
+        else if (c==',') {param=false;lastgz=false;}
+        return HPMORE;
+      }
+      if (np<HPTOK-1) tok[np]=tolower((uint8_t)c);
+      if (np<HPTOK) np++;                      //HPTOK: token too long
+      return HPMORE;
+  }
+  i=hidx-HPBUILTIN;                            //watched header
+  if (np>=wlen[i]-1) return HPMORE;          //value cut
+  wbuff[i][np++]=c;
+  return HPMORE;
+}
+
+/*
+* Parameter q=0 (q=0.0 ...): coding refused
+*/
+static bool qZero(char *tok)
+{
+  if ((tok[0]!='q')||(tok[1]!='=')||(tok[2]!='0')) return false;
+  tok=tok+3;
+  if (*tok=='.') tok++;
+  while (*tok=='0') tok++;
+  return (*tok=='\0');
+}
+
+void HTTPPARSER::endToken()
+{
+  if ((np==0)||(np>HPTOK-1)) return;
+  tok[np]='\0';
+  if (param)                                   //parameter of last token
+  {
+    if ((hidx==HB_AENC)&&lastgz&&qZero(tok)) flags&=~HPGZIP;
+    return;
+  }
+  if (hidx==HB_CONN)
+  {
+    if (strcmp_P(tok,hpClose)==0) flags|=HPCLOSE;
+    else if (strcmp_P(tok,hpKeep)==0) flags|=HPKEEP;
+  }
+  else if (hidx==HB_TENC) {if (strcmp_P(tok,hpChunked)==0) flags|=HPCHUNKED;}
+  else if (strcmp_P(tok,hpGzip)==0) {flags|=HPGZIP;lastgz=true;}
+  else lastgz=false;
+}
@@ -0,0 +1,103 @@
+/* ========================================================================== */
+/*                                                                            */
+/*   HTTP request parser                                                      */
+/*   (c) 2014 Author Daniele Denaro                                           */
+/*                                                                            */
+/*   Description                                                              */
+/*   Byte driven state machine: request can be given in pieces of any length  */
+/*   (also one byte at a time) as it arrives from socket. It extracts method, */
+/*   path, query, version, Content-Length, connection and gzip flags and the  */
+/*   value of headers watched by caller, in storage given by caller, with     */
+/*   limits.                                                                  */
+/*   Nothing is allocated. Parsing stops at the empty line ending headers:    */
+/*   body (Content-Length bytes) follows.                                     */
+/*                                                                            */
+/*   begin(path,lpath,query,lquery) : new request and its storage             */
+/*   beginResponse() : new response (client): status line gives version and  */
+/*                     code, headers as request                               */
+/*   watch(name,buff,lbuff) : value of header name (PROGMEM) in buff          */
+/*   parse(data,len,used) : HPMORE (more data needed), HPDONE (headers end)   */
+/*                          or error (HTTP status code to answer)             */
+/*                          used: bytes used (after HPDONE: body follows)     */
+/*                                                                            */
+/* ========================================================================== */
+
+#ifndef HTTPPARSER_h
+#define HTTPPARSER_h
+
+#include <avr/pgmspace.h>
+#include <ctype.h>
+#include <string.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+#define HPWATCH 4          //max headers watched by caller
+#define HPBUILTIN 4        //headers decoded by parser
+#define HPMAXHEAD 2048     //max length of request line and headers (not for
+                           //responses: server headers can be long)
+#define HPTOK 12           //buffer for method, version and value tokens
+
+// parse results
+#define HPMORE 0           //more data needed
+#define HPDONE 1           //request line and headers complete
+#define HPBAD 400          //bad request
+#define HPMETHOD 405       //method unknown
+#define HPURILONG 414      //path or query longer than storage
+#define HPHEADLONG 431     //headers too long
+
+// methods (bit mask)
+#define HPGET 1
+#define HPPOST 2
+#define HPPUT 4
+#define HPDELETE 8
+#define HPHEAD 16
+
+// flags
+#define HPCLOSE 1          //Connection: close
+#define HPKEEP 2           //Connection: keep-alive
+#define HPCHUNKED 4        //Transfer-Encoding: chunked (no Content-Length)
+#define HPGZIP 8           //Accept-Encoding: gzip
+
+
+class HTTPPARSER
+{
+public:
+     void begin(char *path,uint8_t lpath,char *query,uint8_t lquery);
+     void beginResponse();
+     void watch(prog_char *name,char *buff,uint8_t lbuff);
+     int parse(uint8_t *data,int len,int *used);
+     bool started();       //request started (not only empty lines)
+
+     uint8_t method;       //HPGET, HPPOST ...
+     uint8_t version;      //10 or 11 (HTTP/1.0 or HTTP/1.1)
+     uint8_t flags;        //HPCLOSE, HPKEEP, HPCHUNKED, HPGZIP
+     long clen;            //Content-Length (-1 if not present)
+     int code;             //status code (response)
+     int status;           //last parse result
+
+private:
+     int step(char c);
+     int valueChar(char c);
+     void endToken();
+     prog_char* hname(uint8_t i);
+
+     char *path;uint8_t lpath;
+     char *query;uint8_t lquery;
+     prog_char *wname[HPWATCH];
+     char *wbuff[HPWATCH];
+     uint8_t wlen[HPWATCH];
+     uint8_t nwatch;
+
+     uint8_t state;        //parser state
+     uint8_t cand;         //headers (bits) matching name being read
+     uint8_t hidx;         //header of value being read (0xFF none)
+     int np;               //position in field being read
+     long nval;            //Content-Length value being read
+     bool param;           //token list: parameters (after ';') being read
+     bool lastgz;          //token list: last token was gzip
+     int nhead;            //length of request line and headers
+     char tok[HPTOK];      //token being read
+};
+
+
+#endif
@@ -0,0 +1,290 @@
+/* ========================================================================== */
+/*                                                                            */
+/*   JSON pull parser                                                         */
+/*   (c) 2014 Author Daniele Denaro                                           */
+/*                                                                            */
+/*   Description                                                              */
+/*   See JSONPARSER.h                                                         */
+/*                                                                            */
+/* ========================================================================== */
+
+#include <JSONPARSER.h>
+
+// parser states
+#define JS_VALUE   0       //value expected
+#define JS_VORC    1       //value or ']' (array start)
+#define JS_KORC    2       //key or '}' (object start)
+#define JS_KEY     3       //key expected (after ',')
+#define JS_COLON   4       //':' expected
+#define JS_AFTER   5       //',' or close expected
+#define JS_STRING  6
+#define JS_ESCAPE  7
+#define JS_UNICODE 8
+#define JS_NUMBER  9
+#define JS_LITERAL 10
+#define JS_DONE    11
+#define JS_ERROR   12
+
+#define LEVEL(d) ((uint16_t)1<<(d))
+
+prog_char jpEscapes[] PROGMEM="\"\"\\\\//b\bf\fn\nr\rt\t";   //escape, char
+
+
+/*
+* New document. Selections are cleared.
+*/
+void JSONPARSER::begin()
+{
+  nsel=0;found=0;match=0;
+  state=JS_VALUE;depth=0;arr=0;cur=0;
+  pmask[0]=0;idx[0]=0;
+  value[0]='\0';cut=false;np=0;
+}
+
+/*
+* Value of path (PROGMEM string, see JSONPARSER.h) will be copied in buff
+* (null terminated); empty string if not found (see found). Value longer
+* than lbuff-1 is cut.
+*/
+void JSONPARSER::select(prog_char *path,char *buff,uint8_t lbuff)
+{
+  uint8_t n=1;
+  char c;
+  prog_char *p=path;
+  if ((nsel>=JPSELECT)||(lbuff==0)) return;
+  while ((c=pgm_read_byte(p++))!='\0') if (c=='.') n++;
+  spath[nsel]=path;sbuff[nsel]=buff;slen[nsel]=lbuff;snseg[nsel]=n;
+  buff[0]='\0';
+  pmask[0]|=1<<nsel;
+  nsel++;
+}
+
+/*
+* Parses data until a token is complete. Returns the token (value has its
+* text) or JPMORE (all data used), JPDONE, JPERROR.
+* used: bytes used.
+*/
+int JSONPARSER::parse(uint8_t *data,int len,int *used)
+{
+  int i,r=JPMORE;
+  bool again;
+  for (i=0;i<len;i++)
+  {
+    if ((state==JS_DONE)||(state==JS_ERROR)) break;
+    r=step((char)data[i],&again);
+    if (again) i--;                        //byte ends token and is read again
+    if (r!=JPMORE) {i++;break;}
+  }
+  if (state==JS_DONE) {if (r==JPMORE) {r=JPDONE;i=len;}}  //trailing bytes dropped
+  else if (state==JS_ERROR) r=JPERROR;
+  if (used!=NULL) *used=i;
+  return r;
+}
+
+/*
+* Parses all data (selected values are copied). Returns JPMORE, JPDONE or
+* JPERROR.
+*/
+int JSONPARSER::feed(uint8_t *data,int len)
+{
+  int r,n;
+  do
+  {
+    r=parse(data,len,&n);
+    data=data+n;len=len-n;
+  } while ((r!=JPMORE)&&(r!=JPDONE)&&(r!=JPERROR));
+  return r;
+}
+
+/*
+* One byte of document. again: byte not used (it ends a number or literal).
+*/
+int JSONPARSER::step(char c,bool *again)
+{
+  prog_char *p;
+  char e;
+  *again=false;
+  switch (state)
+  {
+    case JS_VORC:
+      if (c==']') return close(c);
+    case JS_VALUE:
+      if (isspace((uint8_t)c)) return JPMORE;
+      return valueStart(c);
+
+    case JS_KORC:
+      if (c=='}') return close(c);
+    case JS_KEY:
+      if (isspace((uint8_t)c)) return JPMORE;
+      if (c!='"') return error();
+      key=true;match=0;np=0;value[0]='\0';cut=false;
+      state=JS_STRING;
+      return JPMORE;
+
+    case JS_COLON:
+      if (isspace((uint8_t)c)) return JPMORE;
+      if (c!=':') return error();
+      state=JS_VALUE;
+      return JPMORE;
+
+    case JS_AFTER:
+      if (isspace((uint8_t)c)) return JPMORE;
+      if (c==',')
+      {
+        if (arr&LEVEL(depth)) {idx[depth]++;state=JS_VALUE;} else state=JS_KEY;
+        return JPMORE;
+      }
+      return close(c);
+
+    case JS_STRING:
+      if (c=='"')
+      {
+        if (!key) return valueEnd(JPSTRING);
+        cur=segSelect(value,0);
+        state=JS_COLON;
+        return JPKEY;
+      }
+      if (c=='\\') {state=JS_ESCAPE;return JPMORE;}
+      if ((uint8_t)c<' ') return error();
+      putChar(c);
+      return JPMORE;
+
+    case JS_ESCAPE:
+      if (c=='u') {u=0;nu=0;state=JS_UNICODE;return JPMORE;}
+      for (p=jpEscapes;(e=pgm_read_byte(p))!='\0';p=p+2)
+        if (e==c) {putChar(pgm_read_byte(p+1));state=JS_STRING;return JPMORE;}
+      return error();
+
+    case JS_UNICODE:
+      if (!isxdigit((uint8_t)c)) return error();
+      u=(u<<4)|(isdigit((uint8_t)c)?c-'0':(tolower((uint8_t)c)-'a'+10));
+      if (++nu==4) {putUtf8(u);state=JS_STRING;}
+      return JPMORE;
+
+    case JS_NUMBER:
+      if (isdigit((uint8_t)c)||(c=='.')||(c=='e')||(c=='E')||(c=='+')||(c=='-'))
+        {putChar(c);return JPMORE;}
+      *again=true;
+      return valueEnd(JPNUMBER);
+
+    case JS_LITERAL:
+      if (isalpha((uint8_t)c)) {putChar(c);return JPMORE;}
+      *again=true;
+      if ((strcmp(value,"true")==0)||(strcmp(value,"false")==0)) return valueEnd(JPBOOL);
+      if (strcmp(value,"null")==0) return valueEnd(JPNULL);
+      return error();
+  }
+  return JPMORE;
+}
+
+/*
+* First byte of a value: selections matching its path are cleared and will
+* get its text.
+*/
+int JSONPARSER::valueStart(char c)
+{
+  uint8_t i;
+  if ((depth>0)&&(arr&LEVEL(depth))) cur=segSelect(NULL,idx[depth]);
+  else if (depth==0) cur=pmask[0];
+  match=0;
+  for (i=0;i<nsel;i++)
+    if ((cur&(1<<i))&&(snseg[i]==depth)) {match|=1<<i;sbuff[i][0]='\0';}
+  found|=match;
+  key=false;np=0;value[0]='\0';cut=false;
+  if (c=='{') return push(false);
+  if (c=='[') return push(true);
+  if (c=='"') {state=JS_STRING;return JPMORE;}
+  if ((c=='-')||isdigit((uint8_t)c)) state=JS_NUMBER;
+  else if (isalpha((uint8_t)c)) state=JS_LITERAL;
+  else return error();
+  putChar(c);
+  return JPMORE;
+}
+
+int JSONPARSER::push(bool array)
+{
+  if (depth>=JPDEPTH) return error();
+  depth++;
+  pmask[depth]=cur;idx[depth]=0;
+  if (array) {arr|=LEVEL(depth);state=JS_VORC;return JPARRAY;}
+  arr&=~LEVEL(depth);state=JS_KORC;
+  return JPOBJECT;
+}
+
+/*
+* '}' or ']': must close the last object/array opened
+*/
+int JSONPARSER::close(char c)
+{
+  if ((depth==0)||(c!=((arr&LEVEL(depth))?']':'}'))) return error();
+  depth--;
+  value[0]='\0';match=0;
+  return valueEnd(JPEND);
+}
+
+int JSONPARSER::valueEnd(int token)
+{
+  state=(depth==0)?JS_DONE:JS_AFTER;
+  return token;
+}
+
+int JSONPARSER::error()
+{
+  state=JS_ERROR;
+  return JPERROR;
+}
+
+/*
+* Char of key or value: in value and in matching selections
+*/
+void JSONPARSER::putChar(char c)
+{
+  uint8_t i;
+  if (np<JPVALUE-1) {value[np]=c;value[np+1]='\0';} else cut=true;
+  for (i=0;i<nsel;i++)
+    if ((match&(1<<i))&&(np<slen[i]-1)) {sbuff[i][np]=c;sbuff[i][np+1]='\0';}
+  np++;
+}
+
+/*
+* \uXXXX as UTF-8 (surrogate pairs are not joined)
+*/
+void JSONPARSER::putUtf8(uint16_t u)
+{
+  if (u<0x80) {putChar(u);return;}
+  if (u<0x800) {putChar(0xC0|(u>>6));putChar(0x80|(u&0x3F));return;}
+  putChar(0xE0|(u>>12));putChar(0x80|((u>>6)&0x3F));putChar(0x80|(u&0x3F));
+}
+
+/*
+* Selections of current level whose path segment (level depth) is key (if
+* not NULL) or array index, or '*'.
+*/
+uint8_t JSONPARSER::segSelect(char *key,uint16_t index)
+{
+  uint8_t i,d,sel=0;
+  char c;
+  int k;
+  uint16_t n;
+  bool ok;
+  prog_char *p;
+  for (i=0;i<nsel;i++)
+  {
+    if (!(pmask[depth]&(1<<i))||(snseg[i]<depth)) continue;
+    p=spath[i];
+    for (d=1;d<depth;p++) if (pgm_read_byte(p)=='.') d++;
+    if ((pgm_read_byte(p)=='*')&&
+        ((pgm_read_byte(p+1)=='.')||(pgm_read_byte(p+1)=='\0'))) {sel|=1<<i;continue;}
+    ok=true;k=0;n=0;
+    while (((c=pgm_read_byte(p++))!='\0')&&(c!='.'))
+    {
+      if (key!=NULL) {if (key[k]!=c) ok=false; else k++;}
+      else if (isdigit((uint8_t)c)) {n=n*10+c-'0';k++;}
+      else ok=false;
+    }
+    if (key!=NULL) ok=ok&&(key[k]=='\0')&&!cut;
+    else ok=ok&&(k>0)&&(n==index);
+    if (ok) sel|=1<<i;
+  }
+  return sel;
+}
@@ -0,0 +1,99 @@
+/* ========================================================================== */
+/*                                                                            */
+/*   JSON pull parser                                                         */
+/*   (c) 2014 Author Daniele Denaro                                           */
+/*                                                                            */
+/*   Description                                                              */
+/*   Byte driven tokenizer: JSON text can be given in pieces of any length    */
+/*   (as getNextResponseBuffer gives them). Constant memory: nothing is       */
+/*   allocated and the document is never stored, only the token being read   */
+/*   (cut at JPVALUE-1 chars) and the path to it (JPDEPTH levels).            */
+/*   Values of selected paths are copied in buffers given by caller while    */
+/*   they are read (full length up to buffer size).                           */
+/*                                                                            */
+/*   begin() : new document (selections cleared)                              */
+/*   select(path,buff,lbuff) : value of path (PROGMEM) in buff                */
+/*         path: keys and array indexes separated by '.', '*' for any key or  */
+/*         index (last matching value is kept). Ex: "main.temp",             */
+/*         "weather.0.description", "list.*.dt"                               */
+/*   parse(data,len,used) : next token (JPOBJECT, JPKEY, JPSTRING ...) with   */
+/*         its text in value, or JPMORE (more data needed), JPDONE (document  */
+/*         end), JPERROR; used: bytes used                                    */
+/*   feed(data,len) : parse all data (only selections): JPMORE, JPDONE or     */
+/*         JPERROR                                                            */
+/*                                                                            */
+/*   A number as whole document ends at the first byte after it.              */
+/*                                                                            */
+/* ========================================================================== */
+
+#ifndef JSONPARSER_h
+#define JSONPARSER_h
+
+#include <avr/pgmspace.h>
+#include <ctype.h>
+#include <string.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+#define JPSELECT 4         //max paths selected by caller
+#define JPDEPTH 8          //max nested objects/arrays
+#define JPVALUE 24         //buffer for key and value tokens
+
+// parse results (tokens)
+#define JPMORE 0           //more data needed
+#define JPDONE 1           //document complete
+#define JPERROR 2          //syntax error or too deep
+#define JPOBJECT 3         //'{'
+#define JPARRAY 4          //'['
+#define JPEND 5            //'}' or ']'
+#define JPKEY 6            //object key (in value)
+#define JPSTRING 7         //string (in value, unescaped)
+#define JPNUMBER 8         //number (in value, as text)
+#define JPBOOL 9           //"true" or "false" in value
+#define JPNULL 10          //null
+
+
+class JSONPARSER
+{
+public:
+     void begin();
+     void select(prog_char *path,char *buff,uint8_t lbuff);
+     int parse(uint8_t *data,int len,int *used);
+     int feed(uint8_t *data,int len);
+
+     char value[JPVALUE];  //text of last key or value token
+     bool cut;             //value longer than JPVALUE-1
+     uint8_t depth;        //open objects/arrays
+     uint8_t match;        //selections (bits) matched by last value token
+     uint8_t found;        //selections (bits) found in document
+
+private:
+     int step(char c,bool *again);
+     int valueStart(char c);
+     int push(bool array);
+     int close(char c);
+     int valueEnd(int token);
+     int error();
+     void putChar(char c);
+     void putUtf8(uint16_t u);
+     uint8_t segSelect(char *key,uint16_t index);
+
+     prog_char *spath[JPSELECT];
+     char *sbuff[JPSELECT];
+     uint8_t slen[JPSELECT];
+     uint8_t snseg[JPSELECT];   //segments of path
+     uint8_t nsel;
+
+     uint8_t state;        //parser state
+     bool key;             //string being read is a key
+     uint8_t cur;          //selections matching path of next value
+     uint8_t pmask[JPDEPTH+1];  //selections matching path of each level
+     uint16_t idx[JPDEPTH+1];   //array index of each level
+     uint16_t arr;         //bit per level: array (else object)
+     int np;               //position in token being read
+     uint16_t u;           //\uXXXX being read
+     uint8_t nu;
+};
+
+
+#endif
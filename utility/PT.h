@@ -0,0 +1,55 @@
+/* ========================================================================== */
+/*                                                                            */
+/*   Protothreads: stackless tasks for Arduino                                */
+/*   Macros after A. Dunkels protothreads (local continuations by switch)     */
+/*                                                                            */
+/*   Description                                                              */
+/*   A task is a function with a PT state. It runs until it must wait,        */
+/*   then returns PT_WAITING (or PT_YIELDED) and the next call resumes it     */
+/*   from the same point. PT_ENDED (or PT_EXITED) when finished.              */
+/*   Local variables are not kept between calls: use task state fields.       */
+/*   Don't use switch statements inside task body (macros use switch).       */
+/*   Only one PT_WAIT/PT_YIELD/PT_SPAWN macro per source line.                */
+/*                                                                            */
+/* ========================================================================== */
+
+#ifndef PT_h
+#define PT_h
+
+typedef struct
+{
+  unsigned int lc;                 //local continuation (0: task start)
+} PT;
+
+#define PT_WAITING 0               //task is waiting
+#define PT_YIELDED 1               //task gave up cpu
+#define PT_EXITED  2               //task exited before end
+#define PT_ENDED   3               //task ended
+
+#define PT_INIT(pt)   (pt)->lc=0
+
+#define PT_BEGIN(pt)  {char PT_YIELD_FLAG=1;(void)PT_YIELD_FLAG;\
+                       switch((pt)->lc){case 0:
+
+#define PT_END(pt)    } PT_YIELD_FLAG=0;PT_INIT(pt);return PT_ENDED;}
+
+#define PT_WAIT_UNTIL(pt,cond) do{(pt)->lc=__LINE__;case __LINE__:\
+                               if(!(cond)) return PT_WAITING;}while(0)
+
+#define PT_WAIT_WHILE(pt,cond) PT_WAIT_UNTIL((pt),!(cond))
+
+#define PT_SCHEDULE(f) ((f)<PT_EXITED)
+
+#define PT_WAIT_THREAD(pt,thread) PT_WAIT_WHILE((pt),PT_SCHEDULE(thread))
+
+#define PT_SPAWN(pt,child,thread) do{PT_INIT(child);\
+                                  PT_WAIT_THREAD((pt),(thread));}while(0)
+
+#define PT_YIELD(pt)  do{PT_YIELD_FLAG=0;(pt)->lc=__LINE__;case __LINE__:\
+                       if(PT_YIELD_FLAG==0) return PT_YIELDED;}while(0)
+
+#define PT_RESTART(pt) do{PT_INIT(pt);return PT_WAITING;}while(0)
+
+#define PT_EXIT(pt)   do{PT_INIT(pt);return PT_EXITED;}while(0)
+
+#endif
@@ -440,6 +440,33 @@ int SoftwareSerialWIFI::read()
   return d;
 }
 
+// Bulk read: copy up to len buffered bytes in one call.
+// The circular buffer is copied with (at most) two memcpy, so payloads
+// are not pulled one byte at a time through the virtual read().
+// Returns the number of bytes copied (0 if buffer is empty).
+int SoftwareSerialWIFI::drain(uint8_t *buffer, int len)
+{
+  if (!isListening() || len <= 0)
+    return 0;
+
+  // Only the interrupt handler moves tail, so a snapshot is safe
+  uint8_t head = _receive_buffer_head;
+  uint8_t tail = _receive_buffer_tail;
+  int n = (tail + _SS_MAX_RX_BUFF - head) % _SS_MAX_RX_BUFF;
+  if (n > len)
+    n = len;
+
+  int first = _SS_MAX_RX_BUFF - head;
+  if (first > n)
+    first = n;
+  memcpy(buffer, &_receive_buffer[head], first);
+  if (n > first)
+    memcpy(buffer + first, _receive_buffer, n - first);
+
+  _receive_buffer_head = (head + n) % _SS_MAX_RX_BUFF;
+  return n;
+}
+
 int SoftwareSerialWIFI::available()
 {
   if (!isListening())
@@ -94,6 +94,7 @@ public:
   bool isListening() { return this == active_object; }
   bool overflow() { bool ret = _buffer_overflow; _buffer_overflow = false; return ret; }
   int peek();
+  int drain(uint8_t *buffer, int len);
 
   virtual size_t write(uint8_t byte);
   virtual int read();